@@ -0,0 +1,226 @@
+#include "N2K.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+// ============ Lectura little-endian ============
+static inline uint16_t u16(const uint8_t* p){ return (uint16_t)(p[0] | (p[1]<<8)); }
+static inline int16_t  i16(const uint8_t* p){ return (int16_t)u16(p); }
+static inline uint32_t u32(const uint8_t* p){ return (uint32_t)p[0] | ((uint32_t)p[1]<<8) | ((uint32_t)p[2]<<16) | ((uint32_t)p[3]<<24); }
+static inline int32_t  i32(const uint8_t* p){ return (int32_t)u32(p); }
+static inline int64_t  i64(const uint8_t* p){ return (int64_t)((uint64_t)u32(p) | ((uint64_t)u32(p+4)<<32)); }
+
+// Valores "no disponible" de NMEA 2000
+static const uint16_t NA_U16 = 0xFFFF;
+static const int16_t  NA_I16 = 0x7FFF;
+static const uint32_t NA_U32 = 0xFFFFFFFF;
+static const int32_t  NA_I32 = 0x7FFFFFFF;
+static const int64_t  NA_I64 = 0x7FFFFFFFFFFFFFFFLL;
+
+static const double RAD_TO_DEG_ = 57.29577951308232;
+static const double MS_TO_KN    = 1.943844492;
+
+// "ddmm.mmmmm,N" / "dddmm.mmmmm,E"
+static int fmtLatLon(char* b, size_t n, double deg, bool lon){
+  char h = lon ? (deg<0 ? 'W' : 'E') : (deg<0 ? 'S' : 'N');
+  deg = fabs(deg);
+  int d = (int)deg;
+  double m = (deg - d) * 60.0;
+  if(m >= 59.999995){ d++; m = 0; }
+  return lon ? snprintf(b, n, "%03d%08.5f,%c", d, m, h)
+             : snprintf(b, n, "%02d%08.5f,%c", d, m, h);
+}
+// Ángulo en 1e-4 rad → grados 0..360
+static double angDeg(uint16_t raw){
+  double d = raw * 1e-4 * RAD_TO_DEG_;
+  while(d >= 360.0) d -= 360.0;
+  return d;
+}
+// Días desde 1970-01-01 → ddmmyy (civil_from_days)
+static unsigned ddmmyy(uint16_t days){
+  int32_t z = (int32_t)days + 719468;
+  int32_t era = z / 146097;
+  uint32_t doe = (uint32_t)(z - era*146097);
+  uint32_t yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+  int32_t  y   = (int32_t)yoe + era*400;
+  uint32_t doy = doe - (365*yoe + yoe/4 - yoe/100);
+  uint32_t mp  = (5*doy + 2)/153;
+  uint32_t dd  = doy - (153*mp + 2)/5 + 1;
+  uint32_t mm  = mp < 10 ? mp + 3 : mp - 9;
+  if(mm <= 2) y++;
+  return dd*10000 + mm*100 + (unsigned)(y % 100);
+}
+// Segundos del día ×1e4 → "hhmmss.ss"
+static void fmtTime(char* b, size_t n, uint32_t t4){
+  uint32_t cs = t4 / 100;
+  snprintf(b, n, "%02lu%02lu%02lu.%02lu",
+           (unsigned long)(cs/360000), (unsigned long)((cs/6000)%60),
+           (unsigned long)((cs/100)%60), (unsigned long)(cs%100));
+}
+
+// ============ Fast-packet ============
+bool N2kToNmea::isFastPacket(uint32_t pgn){
+  switch(pgn){
+    case 126464: case 126996: case 126998: case 127233: case 127237: case 127489:
+    case 128275: case 129029: case 129038: case 129039: case 129040: case 129041:
+    case 129284: case 129285: case 129540: case 129793: case 129794: case 129798:
+    case 129809: case 129810: case 130074: case 130577:
+      return true;
+  }
+  return false;
+}
+
+void N2kToNmea::onFrame(const N2kFrame& f, uint32_t nowMs){
+  stats_.frames++;
+  uint32_t pgn = n2kPgn(f.id);
+  uint8_t  src = n2kSource(f.id);
+  if(isFastPacket(pgn)){ fastPacket(pgn, src, f, nowMs); return; }
+  if(decode(pgn, src, f.data, f.len)) stats_.decoded++; else stats_.ignored++;
+}
+
+// Trama 0: [seq<<5 | 0][largo][6 datos]  ·  Trama k: [seq<<5 | k][7 datos]
+void N2kToNmea::fastPacket(uint32_t pgn, uint8_t src, const N2kFrame& f, uint32_t nowMs){
+  if(f.len < 2) return;
+  const uint8_t seq = f.data[0] >> 5;
+  const uint8_t fr  = f.data[0] & 0x1F;
+
+  if(fr == 0){
+    FpSlot* s = nullptr;
+    FpSlot* oldest = &fp_[0];
+    for(auto& e : fp_){
+      if(e.used && nowMs - e.startMs > FP_TIMEOUT_MS){ e.used = false; stats_.fpDropped++; }
+      if(e.used && e.pgn==pgn && e.src==src){ s = &e; stats_.fpDropped++; break; }   // reinicio sin terminar
+      if(!e.used && !s) s = &e;
+      if(e.startMs - oldest->startMs > 0x80000000u) oldest = &e;
+    }
+    if(!s){ s = oldest; stats_.fpDropped++; }      // tabla llena: se pisa el más viejo
+    s->used = true; s->pgn = pgn; s->src = src; s->seq = seq; s->startMs = nowMs;
+    s->expected = f.data[1] > FP_MAX ? FP_MAX : f.data[1];
+    s->got = 0; s->nextFrame = 1;
+    size_t n = f.len - 2; if(n > s->expected) n = s->expected;
+    memcpy(s->buf, f.data + 2, n); s->got = (uint8_t)n;
+  } else {
+    FpSlot* s = nullptr;
+    for(auto& e : fp_) if(e.used && e.pgn==pgn && e.src==src && e.seq==seq){ s = &e; break; }
+    if(!s) return;                                 // nos perdimos la trama 0
+    if(fr != s->nextFrame){ s->used = false; stats_.fpDropped++; return; }
+    size_t n = f.len - 1; if(n > (size_t)(s->expected - s->got)) n = s->expected - s->got;
+    memcpy(s->buf + s->got, f.data + 1, n); s->got += (uint8_t)n;
+    s->nextFrame++;
+  }
+
+  for(auto& e : fp_){
+    if(e.used && e.pgn==pgn && e.src==src && e.got >= e.expected){
+      e.used = false;
+      stats_.fpComplete++;
+      if(decode(pgn, src, e.buf, e.expected)) stats_.decoded++; else stats_.ignored++;
+      break;
+    }
+  }
+}
+
+// ============ Salida ============
+void N2kToNmea::out(uint32_t pgn, uint8_t src, const char* body){
+  char s[100];
+  uint8_t cs = 0;
+  for(const char* p = body; *p; p++) cs ^= (uint8_t)*p;
+  snprintf(s, sizeof(s), "$%s*%02X", body, cs);
+  emit_(s, pgn, src, ctx_);
+}
+
+// ============ PGNs ============
+bool N2kToNmea::decode(uint32_t pgn, uint8_t src, const uint8_t* d, size_t len){
+  char b[96];
+  switch(pgn){
+    case 129025: {                                   // Position, Rapid Update → GLL
+      if(len < 8) return false;
+      int32_t la = i32(d), lo = i32(d+4);
+      if(la==NA_I32 || lo==NA_I32) return false;
+      int n = snprintf(b, sizeof(b), "GPGLL,");
+      n += fmtLatLon(b+n, sizeof(b)-n, la*1e-7, false); b[n++]=',';
+      n += fmtLatLon(b+n, sizeof(b)-n, lo*1e-7, true);
+      snprintf(b+n, sizeof(b)-n, ",,A,A");
+      out(pgn, src, b);
+      return true;
+    }
+    case 129026: {                                   // COG & SOG, Rapid Update → VTG
+      if(len < 6) return false;
+      uint8_t  ref = d[1] & 0x03;                    // 0 verdadero, 1 magnético
+      uint16_t cog = u16(d+2), sog = u16(d+4);
+      if(sog==NA_U16) return false;
+      char c[12] = "";
+      if(cog!=NA_U16) snprintf(c, sizeof(c), "%.1f", angDeg(cog));
+      double kn = sog * 0.01 * MS_TO_KN;
+      snprintf(b, sizeof(b), "GPVTG,%s,T,%s,M,%.1f,N,%.1f,K,A",
+               ref==0 ? c : "", ref==1 ? c : "", kn, sog * 0.01 * 3.6);
+      out(pgn, src, b);
+      return true;
+    }
+    case 127250: {                                   // Vessel Heading → HDT / HDG
+      if(len < 8) return false;
+      uint16_t hdg = u16(d+1);
+      int16_t  dev = i16(d+3), var = i16(d+5);
+      uint8_t  ref = d[7] & 0x03;
+      if(hdg==NA_U16) return false;
+      if(ref==0){
+        snprintf(b, sizeof(b), "HCHDT,%.1f,T", angDeg(hdg));
+      } else {
+        char ds[12]="", vs[12]="";
+        if(dev!=NA_I16) snprintf(ds, sizeof(ds), "%.1f,%c", fabs(dev*1e-4*RAD_TO_DEG_), dev<0?'W':'E'); else strcpy(ds, ",");
+        if(var!=NA_I16) snprintf(vs, sizeof(vs), "%.1f,%c", fabs(var*1e-4*RAD_TO_DEG_), var<0?'W':'E'); else strcpy(vs, ",");
+        snprintf(b, sizeof(b), "HCHDG,%.1f,%s,%s", angDeg(hdg), ds, vs);
+      }
+      out(pgn, src, b);
+      return true;
+    }
+    case 128267: {                                   // Water Depth → DPT
+      if(len < 7) return false;
+      uint32_t dep = u32(d+1);
+      int16_t  off = i16(d+5);
+      if(dep==NA_U32) return false;
+      int n = snprintf(b, sizeof(b), "SDDPT,%.2f,%.3f", dep*0.01, off==NA_I16 ? 0.0 : off*0.001);
+      if(len >= 8 && d[7] != 0xFF) snprintf(b+n, sizeof(b)-n, ",%u", (unsigned)d[7]*10);
+      out(pgn, src, b);
+      return true;
+    }
+    case 130306: {                                   // Wind Data → MWV
+      if(len < 6) return false;
+      uint16_t spd = u16(d+1), ang = u16(d+3);
+      uint8_t  ref = d[5] & 0x07;                    // 2 aparente, 3/4 verdadero (barco)
+      if(spd==NA_U16 || ang==NA_U16) return false;
+      char r;
+      if(ref==2) r='R'; else if(ref==3 || ref==4) r='T'; else return false;   // 0/1 = referidos al norte
+      snprintf(b, sizeof(b), "WIMWV,%.1f,%c,%.1f,N,A", angDeg(ang), r, spd * 0.01 * MS_TO_KN);
+      out(pgn, src, b);
+      return true;
+    }
+    case 129029: {                                   // GNSS Position Data (fast-packet) → GGA + RMC
+      if(len < 43) return false;
+      uint16_t date = u16(d+1);
+      uint32_t tod  = u32(d+3);
+      int64_t  la = i64(d+7), lo = i64(d+15), alt = i64(d+23);
+      uint8_t  method = d[31] >> 4;
+      uint8_t  sats = d[33];
+      int16_t  hdop = i16(d+34);
+      int32_t  geoid = i32(d+38);
+      if(la==NA_I64 || lo==NA_I64) return false;
+      char t[16]="", pos[40];
+      if(tod!=NA_U32) fmtTime(t, sizeof(t), tod);
+      int n = fmtLatLon(pos, sizeof(pos), la*1e-16, false); pos[n++]=',';
+      fmtLatLon(pos+n, sizeof(pos)-n, lo*1e-16, true);
+      uint8_t q = method <= 5 ? method : 0;
+      char hd[12]="", al[16]="", gs[16]="";
+      if(hdop!=NA_I16)  snprintf(hd, sizeof(hd), "%.1f", hdop*0.01);
+      if(alt!=NA_I64)   snprintf(al, sizeof(al), "%.1f", alt*1e-6);
+      if(geoid!=NA_I32) snprintf(gs, sizeof(gs), "%.1f", geoid*0.01);
+      snprintf(b, sizeof(b), "GPGGA,%s,%s,%u,%02u,%s,%s,M,%s,M,,", t, pos, q, sats==0xFF?0:sats, hd, al, gs);
+      out(pgn, src, b);
+      if(q && date!=NA_U16 && tod!=NA_U32){
+        snprintf(b, sizeof(b), "GPRMC,%s,A,%s,,,%06u,,", t, pos, ddmmyy(date));
+        out(pgn, src, b);
+      }
+      return true;
+    }
+  }
+  return false;
+}
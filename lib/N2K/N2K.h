@@ -0,0 +1,69 @@
+#pragma once
+/* ==============================================================
+   N2K → NMEA 0183
+   Biblioteca portable (sin Arduino): la usa el firmware (TWAI) y la
+   herramienta de host tools/n2k_host (SocketCAN / vcan / candump).
+   ============================================================== */
+#include <stdint.h>
+#include <stddef.h>
+
+struct N2kFrame {
+  uint32_t id;        // identificador extendido de 29 bits
+  uint8_t  len;
+  uint8_t  data[8];
+};
+
+// PGN desde el ID: EDP|DP|PF (+PS si es PDU2)
+inline uint32_t n2kPgn(uint32_t id){
+  uint32_t pgn = (id >> 8) & 0x3FF00;
+  if(((id >> 16) & 0xFF) >= 240) pgn |= (id >> 8) & 0xFF;
+  return pgn;
+}
+inline uint8_t n2kSource(uint32_t id){ return (uint8_t)(id & 0xFF); }
+
+class N2kToNmea {
+public:
+  // Se llama una vez por sentencia generada ("$GPGLL,...*hh", sin CR/LF)
+  typedef void (*EmitFn)(const char* sentence, uint32_t pgn, uint8_t src, void* ctx);
+
+  static const int      FP_SLOTS      = 8;      // mensajes fast-packet en armado a la vez
+  static const int      FP_MAX        = 223;    // 6 + 31*7
+  static const uint32_t FP_TIMEOUT_MS = 750;
+
+  struct Stats {
+    uint32_t frames;      // tramas recibidas
+    uint32_t decoded;     // PGNs convertidos (≥1 sentencia)
+    uint32_t ignored;     // PGNs no soportados o con datos N/A
+    uint32_t fpComplete;  // fast-packets completos
+    uint32_t fpDropped;   // fast-packets descartados (trama fuera de orden, timeout, tabla llena)
+  };
+
+  N2kToNmea(EmitFn emit, void* ctx) : emit_(emit), ctx_(ctx) {}
+
+  void onFrame(const N2kFrame& f, uint32_t nowMs);
+  const Stats& stats() const { return stats_; }
+
+  static bool isFastPacket(uint32_t pgn);
+
+private:
+  struct FpSlot {
+    bool     used;
+    uint8_t  src;
+    uint8_t  seq;          // contador de secuencia (3 bits)
+    uint8_t  nextFrame;
+    uint8_t  expected;     // largo total anunciado en la trama 0
+    uint8_t  got;
+    uint32_t pgn;
+    uint32_t startMs;
+    uint8_t  buf[FP_MAX];
+  };
+
+  void fastPacket(uint32_t pgn, uint8_t src, const N2kFrame& f, uint32_t nowMs);
+  bool decode(uint32_t pgn, uint8_t src, const uint8_t* d, size_t len);
+  void out(uint32_t pgn, uint8_t src, const char* body);
+
+  EmitFn emit_;
+  void*  ctx_;
+  FpSlot fp_[FP_SLOTS] = {};
+  Stats  stats_ = {};
+};
@@ -0,0 +1,54 @@
+#pragma once
+/* ==============================================================
+   TriplePub — publicación estilo RCU con 3 buffers y un hazard
+   Un lector (el TX loop del generador) toma la versión vigente sin
+   locks; los escritores copian → modifican → publican por swap de
+   puntero y nunca esperan al lector. Portable (sin Arduino): la usa
+   el firmware y el test de host test/host (ThreadSanitizer).
+
+   3 buffers alcanzan: vigente + el que pueda estar leyendo el lector
+   (hazard) + uno libre para el próximo escritor.
+
+   acquire()/release(): sólo desde UN lector.
+   publish()/current(): los escritores se serializan afuera (mutex).
+   ============================================================== */
+#include <atomic>
+
+template<class T>
+class TriplePub {
+public:
+  explicit TriplePub(const T& init) : buf_{init, init, init}, active_(&buf_[0]), hazard_(nullptr) {}
+
+  // Lector: reintenta sólo si justo se publicó otra versión.
+  // Handshake tipo Dekker con publish(): guardar hazard → releer active_ de
+  // este lado, publicar → leer hazard_ del otro. Los cuatro accesos van
+  // seq_cst; con release/acquire la lectura del hazard en el escritor podría
+  // adelantarse a su publicación y reciclar el buffer en uso.
+  const T* acquire(){
+    const T* p;
+    do {
+      p = active_.load(std::memory_order_seq_cst);
+      hazard_.store(p, std::memory_order_seq_cst);
+    } while(p != active_.load(std::memory_order_seq_cst));
+    return p;
+  }
+  void release(){ hazard_.store(nullptr, std::memory_order_release); }
+
+  // Escritor (serializado): copia la vigente, la modifica con fn y la publica
+  template<class F> void publish(F fn){
+    T* cur = active_.load(std::memory_order_relaxed);
+    const T* hz = hazard_.load(std::memory_order_seq_cst);
+    T* next = nullptr;
+    for(auto& b : buf_) if(&b != cur && &b != hz){ next = &b; break; }
+    *next = *cur;
+    fn(*next);
+    active_.store(next, std::memory_order_seq_cst);
+  }
+  // Vigente, para copiar bajo el mismo lock de los escritores
+  const T& current() const { return *active_.load(std::memory_order_acquire); }
+
+private:
+  T buf_[3];
+  std::atomic<T*>       active_;
+  std::atomic<const T*> hazard_;
+};
@@ -1,12 +1,24 @@
 #include <Arduino.h>
+#include <atomic>
+#include <memory>
 #include <WiFi.h>
 #include <WiFiUdp.h>
-#include <WebServer.h>
+#include <AsyncTCP.h>
+#include <ESPAsyncWebServer.h>
+#include <AsyncJson.h>
+#include <ArduinoJson.h>
 #include <ESPmDNS.h>
 #include <Adafruit_NeoPixel.h>
 #include <DNSServer.h>
 #include <Update.h>
+#include <Preferences.h>
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "mbedtls/sha256.h"
+#include "driver/twai.h"
+#include <N2K.h>          // lib/N2K: PGN → 0183 (también compila en host)
+#include <TriplePub.h>    // lib/TriplePub: config del generador sin locks (test en test/host)
+#include "web_assets.h"   // generado por tools/embed_web.py
 
 // === OLED (U8g2) ===
 #include <U8g2lib.h>
@@ -51,37 +63,218 @@ DNSServer dnsServer;
 // ===== LED =====
 #define LED_PIN 48
 #define NUMPIXELS 1
-Adafruit_NeoPixel pixels(NUMPIXELS, LED_PIN, NEO_GRB + NEO_KHZ800);
-unsigned long ledMillis = 0;
-const int LED_DURATION = 50;
-bool ledOn = false;
+Adafruit_NeoPixel pixels(NUMPIXELS, LED_PIN, NEO_GRB + NEO_KHZ800);   // sólo TaskLED llama a show()
+// Orden = prioridad en empate (un error de checksum no queda tapado por las buenas)
+enum LedEvent : uint8_t { LED_EV_BOOT=0, LED_EV_RX_BAD, LED_EV_TX, LED_EV_RX_OK, LED_EV_COUNT };
+const uint32_t LED_COLORS[LED_EV_COUNT] = {
+  Adafruit_NeoPixel::Color(0,255,255),   // boot: cian
+  Adafruit_NeoPixel::Color(255,0,0),     // RX inválida: rojo
+  Adafruit_NeoPixel::Color(0,0,255),     // TX: azul
+  Adafruit_NeoPixel::Color(0,255,0),     // RX válida: verde
+};
+const uint32_t LED_WINDOW_MS = 50;       // como mucho un destello por ventana
+const uint32_t LED_ON_MS     = 25;
+std::atomic<uint32_t> ledEvents[LED_EV_COUNT];
+std::atomic<uint32_t> ledShows(0);
+std::atomic<uint32_t> ledShowUs(0);      // tiempo acumulado dentro de show()
 
 // ===== UART =====
 HardwareSerial NMEA_Serial(1);
 #define RX_PIN 16
 #define TX_PIN 17
+#define UART_RX_BUF 1024                  // buffer RX del driver (la página HEALTH muestra su ocupación)
 volatile int currentBaud = 4800;
+std::atomic<int> baudRequest(0);          // /setbaud → TaskNMEA lo aplica entre lecturas (0 = nada)
+
+// ===== NMEA 2000 (CAN vía TWAI + transceptor externo, p. ej. SN65HVD230) =====
+#define CAN_TX_PIN 4
+#define CAN_RX_PIN 5
+bool cfgN2k = false;                      // persistido: escuchar el bus N2K (listen-only)
+struct N2kLine { char s[100]; uint32_t pgn; uint32_t rxUs; uint8_t src; };
+QueueHandle_t n2kQueue;                   // TaskCAN → TaskNMEA (el monitor sigue teniendo un solo escritor)
+std::atomic<uint32_t> n2kQueueDrops(0);
+volatile bool n2kBusUp = false;
+
+// ===== Botón =====
+#define BTN_PIN 0                         // BOOT: cambia de página en el OLED
 
 // ===== UDP =====
 WiFiUDP udp;
 IPAddress udpAddress;
+volatile bool netReady = false;
 const int udpPort = 10110;
 
+// ===== TCP (NMEA 0183 sobre TCP, mismo puerto que UDP) =====
+AsyncServer tcpServer(10110);
+static const int TCP_MAX_CLIENTS = 4;
+AsyncClient* tcpClients[TCP_MAX_CLIENTS] = {nullptr};
+volatile uint8_t tcpClientCount = 0;
+SemaphoreHandle_t tcpMutex;
+std::atomic<uint32_t> tcpDrops(0);        // líneas descartadas por cliente lento (sin espacio)
+
 // ===== Web =====
-WebServer server(80);
+// Servidor asíncrono (AsyncTCP): muchas conexiones keep-alive sin task por cliente
+AsyncWebServer server(80);
+AsyncWebSocket skWs("/signalk/v1/stream");   // deltas Signal K (si cfgSkWs)
+const int SK_UDP_PORT = 4123;                // deltas Signal K por UDP broadcast (si cfgSkUdp)
+volatile uint32_t rebootAtMs = 0;          // !=0 → reinicio diferido (post-OTA)
+
+// ===== OTA =====
+// El handler HTTP copia el cuerpo a un pool fijo de trozos y TaskOTA (baja
+// prioridad) los escribe en flash: el monitor/generador siguen hasta el reinicio.
+// El handler corre en la tarea de AsyncTCP y nunca espera: lo recibido no se
+// confirma (ackLater) y TaskOTA reabre la ventana TCP cuando en el pool entra
+// otra ventana entera. Así el pool nunca se queda sin trozos.
+static const size_t   OTA_SLOT_SIZE      = 1460;   // un segmento TCP
+static const int      OTA_WND_SLOTS      = (CONFIG_LWIP_TCP_WND_DEFAULT + OTA_SLOT_SIZE - 1) / OTA_SLOT_SIZE + 2;  // + trozo partido + resto en el parser multipart
+static const int      OTA_SLOTS          = OTA_WND_SLOTS + 4;
+static const uint32_t OTA_IDLE_TIMEOUT_MS = 15000; // upload cortado a la mitad
+static const uint32_t OTA_GATE_MAX_MS    = 200;    // espera máx. a un hueco del UART antes de grabar un sector
+enum OtaPhase : uint8_t { OTA_IDLE=0, OTA_RECEIVING, OTA_VERIFYING, OTA_OK, OTA_FAIL };
+enum OtaMsgKind : uint8_t { OTA_MSG_BEGIN=0, OTA_MSG_DATA, OTA_MSG_END, OTA_MSG_ABORT };
+struct OtaMsg { uint8_t kind; uint8_t slot; uint16_t len; };
+static uint8_t otaPool[OTA_SLOTS][OTA_SLOT_SIZE];
+QueueHandle_t otaQueue;                    // OtaMsg: handler → TaskOTA
+QueueHandle_t otaFree;                     // índices libres de otaPool
+volatile OtaPhase otaPhase = OTA_IDLE;
+volatile bool     otaAborting = false;     // ya se encoló un ABORT: el resto del cuerpo se descarta
+AsyncWebServerRequest* otaOwner = nullptr; // request dueña del upload en curso (sólo se compara)
+AsyncClient*      otaClient = nullptr;     // su conexión, para reabrir la ventana (bajo otaAckMux)
+SemaphoreHandle_t otaAckMux;
+const char* volatile otaError = "";
+uint8_t  otaExpected[32];                  // ?sha256=… opcional del cliente
+bool     otaHasExpected = false;
+uint8_t  otaDigest[32];                    // SHA-256 del archivo completo (al terminar)
+volatile uint32_t otaTotal    = 0;         // Content-Length (incluye el multipart: sólo para el %)
+volatile uint32_t otaReceived = 0;
+volatile uint32_t otaWritten  = 0;
+volatile uint32_t otaStallMaxUs   = 0;     // peor Update.write()
+volatile uint32_t otaStallOverFifo = 0;    // escrituras más largas que lo que aguanta la FIFO del UART
+volatile uint32_t otaGateMs   = 0;         // tiempo total esperando huecos del UART
 
 // ===== Buffers =====
-#define BUFFER_LINES 50
-String nmeaBuffer[BUFFER_LINES];
-int bufferIndex = 0;
-String currentLine = "";
-unsigned long lineStartMs = 0;            // timeout para líneas rotas
+// Consolas web: anillo de líneas numeradas. seq = líneas agregadas desde el
+// arranque; la n vive en lines[n % N]. El cliente pide ?since=<seq> y recibe
+// sólo lo nuevo. Lo protege el mutex de cada consola.
+template<uint32_t N> struct ConsoleRing {
+  String   lines[N];
+  uint32_t seq   = 0;                     // última agregada
+  uint32_t first = 1;                     // primera que sigue valiendo (sube al limpiar)
+  uint32_t rateSeq = 0, rateMs = 0;       // muestra anterior para perSec
+  uint16_t perSec  = 0;                   // líneas/s, se recalcula al pedir (≥ 1 s)
+  void push(const String& l){ seq++; lines[seq % N] = l; }
+  uint16_t rate(uint32_t now){
+    uint32_t dt = now - rateMs;
+    if(dt >= 1000){ perSec = (uint16_t)min<uint32_t>((seq - rateSeq)*1000ull/dt, 0xFFFF); rateSeq = seq; rateMs = now; }
+    return perSec;
+  }
+  void clear(){ for(auto& l : lines) l = String(); first = seq + 1; }
+  // "<seq> <perdidas>\n" + las líneas posteriores a 'from'. Perdidas = las que
+  // el anillo pisó antes de que el cliente las pidiera.
+  String since(uint32_t from, uint32_t* nLines = nullptr) const {
+    if(from > seq) from = 0;              // el equipo reinició: todo de nuevo
+    uint32_t kept  = seq >= N ? seq - N + 1 : 1;
+    uint32_t want  = max(from + 1, first);
+    uint32_t start = max(want, kept);
+    if(nLines) *nLines = seq + 1 - start;
+    String out = String(seq) + " " + String(start - want) + "\n";
+    out.reserve(out.length() + (seq + 1 - start) * 80);
+    for(uint32_t n = start; n <= seq; n++){ out += lines[n % N]; out += '\n'; }
+    return out;
+  }
+  // Sin encabezado, todo lo que queda (clientes viejos)
+  String all() const {
+    String out;
+    for(uint32_t n = max(first, seq >= N ? seq - N + 1 : 1); n <= seq; n++){ out += lines[n % N]; out += '\n'; }
+    return out;
+  }
+};
+#define BUFFER_LINES 200
+ConsoleRing<BUFFER_LINES> nmeaConsole;
+volatile uint32_t lineRxUs = 0;           // llegada estimada del '$'/'!' de la línea en curso (0 = aún no)
+// Estampa de recepción: µs de esp_timer en 32 bits (las restas sin signo aguantan
+// 71 min). Nunca 0: 0 significa "sin estampa" (p. ej. líneas del generador).
+inline uint32_t stampUs(){ return (uint32_t)esp_timer_get_time() | 1; }
 static const size_t MAX_LINE_LEN = 320;   // tope de seguridad
 static const uint32_t LINE_TIMEOUT_MS = 1200;
 
 #define GEN_BUFFER_LINES 200
-String genBuffer[GEN_BUFFER_LINES];
-int genIndex = 0;
+ConsoleRing<GEN_BUFFER_LINES> genConsole;
+
+// ===== Pipeline: ingesta → proceso → salida =====
+// Cada sentencia vive en un registro fijo del pool; entre etapas viajan
+// punteros por colas SPSC sin lock (un productor y un consumidor por cola):
+//   TaskNMEA (ingesta, core 1): UART/N2K/generador → pipeProcQ
+//   TaskProc (core 1): tags, clasificación, streams, parser, dedup, consola, historial → pipeOutQ
+//   TaskOut  (core 0, junto a lwIP): UDP/TCP/IEC 450/Signal K → pipeFreeQ (vuelve a la ingesta)
+// El proceso nunca descarta: lo que no sale por red igual pasa por TaskOut,
+// que es el único que devuelve registros al pool.
+enum PipeKind : uint8_t { PIPE_UART=0, PIPE_N2K, PIPE_GEN };
+struct PipeRec {
+  uint32_t rxUs;                 // llegada del '$'/'!' (0 = generada acá)
+  uint32_t queuedUs;             // stampUs() al entrar a la cola actual
+  uint32_t pgn;                  // PIPE_N2K
+  uint16_t len;
+  uint8_t  kind;                 // PipeKind
+  uint8_t  n2kSrc;
+  int8_t   cat;                  // índice en sensors[] (-1 = desconocida); lo completa TaskProc en RX
+  uint8_t  outs;                 // OUT_BIT(OUT_UDP|OUT_TCP) que le tocan (TaskProc)
+  char     text[MAX_LINE_LEN+1];
+};
+
+template<typename T, uint32_t N>
+struct SpscRing {
+  static_assert((N & (N-1)) == 0, "N potencia de 2");
+  T buf[N];
+  std::atomic<uint32_t> head{0};          // sólo el productor
+  std::atomic<uint32_t> tail{0};          // sólo el consumidor
+  std::atomic<uint32_t> peak{0};          // máx. profundidad vista (productor)
+  bool push(T v){
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t d = h - tail.load(std::memory_order_acquire);
+    if(d >= N) return false;
+    buf[h & (N-1)] = v;
+    head.store(h+1, std::memory_order_release);
+    if(d+1 > peak.load(std::memory_order_relaxed)) peak.store(d+1, std::memory_order_relaxed);
+    return true;
+  }
+  bool pop(T& v){
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if(t == head.load(std::memory_order_acquire)) return false;
+    v = buf[t & (N-1)];
+    tail.store(t+1, std::memory_order_release);
+    return true;
+  }
+  uint32_t depth() const { return head.load(std::memory_order_relaxed) - tail.load(std::memory_order_relaxed); }
+};
+
+static const uint32_t PIPE_POOL = 64;     // ≈ 21 KB; las colas tienen lugar para todo el pool
+PipeRec pipePool[PIPE_POOL];
+SpscRing<PipeRec*, PIPE_POOL> pipeProcQ;  // TaskNMEA → TaskProc
+SpscRing<PipeRec*, PIPE_POOL> pipeOutQ;   // TaskProc → TaskOut
+SpscRing<PipeRec*, PIPE_POOL> pipeFreeQ;  // TaskOut  → TaskNMEA
+TaskHandle_t pipeProcTask = nullptr;
+TaskHandle_t pipeOutTask  = nullptr;
+std::atomic<uint32_t> pipeNoRec(0);       // líneas perdidas por pool agotado
+std::atomic<uint32_t> pipeFreeMin(PIPE_POOL);
+
+// Ubicación de las etapas (ajustable mirando /pipeline)
+static const BaseType_t PIPE_CORE_INGEST = 1, PIPE_PRIO_INGEST = 3;
+static const BaseType_t PIPE_CORE_PROC   = 1, PIPE_PRIO_PROC   = 2;
+static const BaseType_t PIPE_CORE_OUT    = 0, PIPE_PRIO_OUT    = 2;
+
+// Por etapa: espera en la cola (push → pop) y trabajo (pop → siguiente push), en µs
+struct PipeStage {
+  std::atomic<uint32_t> n{0}, waitUs{0}, waitMaxUs{0}, workUs{0}, workMaxUs{0};
+  void record(uint32_t wait, uint32_t work){
+    n.fetch_add(1, std::memory_order_relaxed);
+    waitUs.fetch_add(wait, std::memory_order_relaxed);
+    workUs.fetch_add(work, std::memory_order_relaxed);
+    if(wait > waitMaxUs.load(std::memory_order_relaxed)) waitMaxUs.store(wait, std::memory_order_relaxed);
+    if(work > workMaxUs.load(std::memory_order_relaxed)) workMaxUs.store(work, std::memory_order_relaxed);
+  }
+};
+PipeStage pipeProcStat, pipeOutStat;
 
 // ===== Estado app =====
 enum AppMode { MODE_MONITOR=0, MODE_GENERATOR=1 };
@@ -89,28 +282,80 @@ volatile AppMode appMode = MODE_MONITOR;
 volatile bool monitorRunning   = false;  // arranca pausado
 volatile bool generatorRunning = false;  // arranca pausado
 const int baudRates[4] = {4800,9600,38400,115200};
+bool     cfgAutoResume = false;       // persistido: reanudar MON/GEN al arrancar
+bool     cfgSkipSplash = false;       // persistido: saltear splash
+bool     cfgDedup      = false;       // persistido: suprimir sentencias repetidas
+uint16_t dedupWindowMs    = 2000;     // repetida = mismo cuerpo que la anterior del ID, llegada dentro de esta ventana
+uint16_t dedupKeepAliveMs = 5000;     // igual se emite una cada N ms (keep-alive)
+bool     cfgSkWs       = false;       // persistido: deltas Signal K por WebSocket
+bool     cfgSkUdp      = false;       // persistido: deltas Signal K por UDP
+bool     cfgIec450     = false;       // persistido: UDP en formato IEC 61162-450 (multicast) en vez de broadcast plano
+char     iecSrc[7]     = "II0001";    // s: del tag block (talker + 4 dígitos)
+bool     cfgRxTag      = false;       // persistido: UDP/TCP planos con tag block c: (hora de recepción, s UTC)
+
+// ===== Salidas del monitor =====
+// Cada salida tiene su máscara de categorías (bit i = FILTER_CATS[i], orden de la UI).
+enum OutputId : uint8_t { OUT_WEB=0, OUT_UDP, OUT_TCP, OUT_COUNT };
+#define OUT_BIT(o) (1u<<(o))
+static const char* const OUT_NAMES[OUT_COUNT] = {"web","udp","tcp"};
+static const char* const FILTER_CATS[] = {"GPS","AIS","SOUNDER","VELOCITY","HEADING","RADAR","WEATHER","TRANSDUCER","OTROS"};
+static const uint16_t FILTER_ALL   = 0x1FF;
+static const uint8_t  FILTER_OTROS = 8;
+uint16_t outCatMask[OUT_COUNT] = {FILTER_ALL, FILTER_ALL, FILTER_ALL};   // [OUT_WEB] = filtros de la página Monitor
+
+// Reglas por ID: "GSV" (cualquier talker) o "GPGSV". drop = salidas bloqueadas,
+// minMs = decimación (como mucho 1 cada minMs por salida).
+static const int ID_RULE_MAX = 8;
+struct __attribute__((packed)) IdRule {
+  char     id[6];
+  uint8_t  drop;
+  uint16_t minMs;
+};
+IdRule idRules[ID_RULE_MAX];
+// Seqlock: impar mientras un handler escribe; las entradas de streams[] guardan
+// la generación con la que resolvieron su regla.
+std::atomic<uint32_t> idRulesGen(2);
 
 // ===== Generator =====
 const int MAX_SLOTS = 4;
-struct GenSlot {
-  bool   enabled;
-  String sensor;
-  String sentence;
-  String text;
-};
-GenSlot slots[MAX_SLOTS] = {
-  {true,  "GPS",      "RMC", ""},   // slot 0
-  {false, "GPS",      "VTG", ""},   // slot 1
-  {false, "VELOCITY", "VHW", ""},   // slot 2
-  {false, "HEADING",  "HDT", ""},   // slot 3
-};
-unsigned long slotInterval[MAX_SLOTS] = {500,500,500,500};
 unsigned long lastSentMs  [MAX_SLOTS] = {0,0,0,0};
 
+// Slot en formato POD: lo que ve el TX loop (y lo que se persiste en NVS)
+static const size_t GEN_TEXT_LEN = 100;   // NMEA ≤ 82 + margen
+struct __attribute__((packed)) GenSlotCfg {
+  uint8_t  enabled;
+  char     sensor[12];
+  char     sentence[8];
+  char     text[GEN_TEXT_LEN];   // "" → se genera desde sensor/sentence
+  uint16_t intervalMs;
+};
+struct GenConfig { GenSlotCfg slot[MAX_SLOTS]; };
+
+// Publicación estilo RCU (lib/TriplePub): la config vigente es inmutable y se
+// reemplaza por swap de puntero; el TX loop es el único lector.
+TriplePub<GenConfig> genPub(GenConfig{{
+  {1, "GPS",      "RMC", "", 500},   // slot 0
+  {0, "GPS",      "VTG", "", 500},   // slot 1
+  {0, "VELOCITY", "VHW", "", 500},   // slot 2
+  {0, "HEADING",  "HDT", "", 500},   // slot 3
+}});
+
 // ===== Sync =====
 SemaphoreHandle_t nmeaBufMutex;
 SemaphoreHandle_t genBufMutex;
 SemaphoreHandle_t serialMutex;
+SemaphoreHandle_t slotWriteMutex;   // sólo entre escritores/lectores web (nunca lo toma el generador)
+
+// ===== NMEA 2000 → cola del monitor =====
+// lib/N2K llama a n2kEmit desde TaskCAN; TaskNMEA consume la cola.
+static void n2kEmit(const char* sentence, uint32_t pgn, uint8_t src, void*){
+  if(!(appMode==MODE_MONITOR && monitorRunning)) return;
+  N2kLine l;
+  strncpy(l.s, sentence, sizeof(l.s)-1); l.s[sizeof(l.s)-1]=0;
+  l.pgn = pgn; l.src = src; l.rxUs = stampUs();   // n2kEmit corre dentro de onFrame(): ≈ llegada de la última trama
+  if(xQueueSend(n2kQueue, &l, 0) != pdTRUE) n2kQueueDrops.fetch_add(1, std::memory_order_relaxed);
+}
+N2kToNmea n2k(n2kEmit, nullptr);
 
 // ====== ESTADO para OLED ======
 volatile bool     otaActive = false;
@@ -121,38 +366,241 @@ const uint32_t SENSOR_PRESENT_TTL_MS = 8000;   // 8s (marca “visto” por cons
 const uint32_t SPLASH_MS             = 2500;   // 2.5s splash
 const uint32_t OLED_IDLE_WINDOW_MS   = 3500;   // ventana para mostrar sensores en OLED
 
-// Marcas de última detección/generación por sensor (incluye CUSTOM)
+// Ritmo de un flujo: un solo escritor (TaskProc), lectores web/OLED sin lock.
+// Intervalo y jitter en ms Q4 (x16), EWMA 1/8 y 1/16 (estilo RFC 3550).
+struct RateStat {
+  std::atomic<uint32_t> lastMs {0};
+  std::atomic<uint32_t> count  {0};
+  std::atomic<uint32_t> ivlQ4  {0};   // intervalo medio entre llegadas
+  std::atomic<uint32_t> jitQ4  {0};   // desvío medio respecto de ese intervalo
+  std::atomic<uint32_t> maxGap {0};   // mayor hueco visto (ms)
+};
+enum StreamState : uint8_t { ST_IDLE=0, ST_ACTIVE, ST_STALE };
+
+const uint32_t STALE_MIN_MS      = 1000;      // nunca alarmar antes de 1 s sin datos
+const uint32_t STALE_HOLD_MS     = 600000;    // la alarma se mantiene 10 min
+const uint32_t STALE_MIN_SAMPLES = 5;         // ritmo conocido recién después de N llegadas
+
+void rateStamp(RateStat& r, uint32_t now){
+  uint32_t n = r.count.load(std::memory_order_relaxed);
+  if(n){
+    uint32_t dt  = now - r.lastMs.load(std::memory_order_relaxed);
+    uint32_t dtQ = min<uint32_t>(dt, STALE_HOLD_MS) << 4;
+    uint32_t ivl = r.ivlQ4.load(std::memory_order_relaxed);
+    uint32_t jit = r.jitQ4.load(std::memory_order_relaxed);
+    if(n==1){ ivl = dtQ; jit = 0; }
+    else {
+      int32_t err = (int32_t)dtQ - (int32_t)ivl;
+      ivl = (uint32_t)((int32_t)ivl + err/8);
+      jit = (uint32_t)((int32_t)jit + ((int32_t)abs(err) - (int32_t)jit)/16);
+    }
+    r.ivlQ4.store(ivl, std::memory_order_relaxed);
+    r.jitQ4.store(jit, std::memory_order_relaxed);
+    if(dt > r.maxGap.load(std::memory_order_relaxed)) r.maxGap.store(dt, std::memory_order_relaxed);
+  }
+  r.lastMs.store(now, std::memory_order_relaxed);
+  r.count.store(n+1, std::memory_order_relaxed);
+}
+
+// Con ritmo conocido: STALE si pasaron más de 3 intervalos + 4 jitter sin datos
+StreamState rateState(const RateStat& r, uint32_t now){
+  uint32_t n = r.count.load(std::memory_order_relaxed);
+  if(!n) return ST_IDLE;
+  uint32_t age = now - r.lastMs.load(std::memory_order_relaxed);
+  if(n < STALE_MIN_SAMPLES) return (age <= OLED_IDLE_WINDOW_MS) ? ST_ACTIVE : ST_IDLE;
+  uint32_t limit = (3*r.ivlQ4.load(std::memory_order_relaxed) + 4*r.jitQ4.load(std::memory_order_relaxed)) >> 4;
+  if(limit < STALE_MIN_MS) limit = STALE_MIN_MS;
+  if(age <= limit)         return ST_ACTIVE;
+  if(age <= STALE_HOLD_MS) return ST_STALE;
+  return ST_IDLE;
+}
+const char* stateName(StreamState s){ return s==ST_ACTIVE ? "active" : (s==ST_STALE ? "stale" : "idle"); }
+
+// Ritmo por categoría: recibido (monitor) y generado (incluye CUSTOM)
 struct SensorTrack {
   const char* name;
-  volatile uint32_t lastSeenMs;
-  volatile uint32_t lastGenMs;
+  RateStat    rx;
+  RateStat    gen;
 };
 SensorTrack sensors[] = {
-  {"GPS",        0, 0},
-  {"WEATHER",    0, 0},
-  {"HEADING",    0, 0},
-  {"SOUNDER",    0, 0},
-  {"VELOCITY",   0, 0},
-  {"RADAR",      0, 0},
-  {"TRANSDUCER", 0, 0},
-  {"AIS",        0, 0},
-  {"CUSTOM",     0, 0}
+  {"GPS"}, {"WEATHER"}, {"HEADING"}, {"SOUNDER"}, {"VELOCITY"},
+  {"RADAR"}, {"TRANSDUCER"}, {"AIS"}, {"CUSTOM"}
 };
 const int SENSOR_COUNT = sizeof(sensors)/sizeof(sensors[0]);
+// sensors[i] → bit de FILTER_CATS (CUSTOM cuenta como OTROS)
+static const uint8_t SENSOR_FILTER_BIT[] = {0, 6, 4, 2, 3, 5, 7, 1, FILTER_OTROS};
+static_assert(sizeof(SENSOR_FILTER_BIT) == sizeof(sensors)/sizeof(sensors[0]), "SENSOR_FILTER_BIT desalineado");
+
+// Ritmo por talker+formatter ("GPRMC", "AIVDM"...): tabla fija, sondeo lineal.
+// Sólo TaskProc inserta; la clave se publica al final (release) → los lectores
+// nunca ven una entrada a medio llenar.
+static const int STREAM_MAX = 32;
+struct StreamStat {
+  std::atomic<uint32_t> key {0};   // 5 chars en base 37 (0 = libre)
+  char     id[6];
+  int8_t   cat;                    // índice en sensors[] (-1 = OTROS)
+  RateStat rx;
+  // Filtro resuelto (sólo TaskProc)
+  uint32_t ruleGen;
+  uint8_t  drop;
+  uint16_t minMs;
+  uint32_t lastOutMs[OUT_COUNT];
+  // Deduplicación (sólo TaskProc)
+  uint32_t lastHash;
+  uint32_t lastArrivalMs;
+  uint32_t lastEmitMs;
+  std::atomic<uint32_t> suppressed {0};
+};
+StreamStat streams[STREAM_MAX];
+std::atomic<uint32_t> streamOverflow(0);   // sentencias sin lugar en la tabla
+std::atomic<uint32_t> statDedup(0);        // total suprimidas por repetidas
+
+// ====== Métricas (página HEALTH) ======
+// El hot path sólo hace fetch_add sobre totales; TaskUI los muestrea 1 vez por
+// segundo y guarda los deltas en anillos de STAT_HIST segundos (ventana móvil).
+std::atomic<uint32_t> statRxLines (0);   // líneas recibidas por UART
+std::atomic<uint32_t> statOutLines(0);   // sentencias emitidas (UDP / TX del generador)
+std::atomic<uint32_t> statCsBad   (0);   // checksum NMEA inválido
+std::atomic<uint32_t> statUartOvf (0);   // desbordes del RX (FIFO de hardware o buffer del driver)
+volatile uint16_t     uartPeak = 0;      // máx. bytes pendientes en el RX del UART
+
+static const int STAT_HIST = 64;         // segundos de historia (sparkline = 2 px por muestra)
+uint16_t statRxHist [STAT_HIST];
+uint16_t statOutHist[STAT_HIST];
+uint16_t statCsHist [STAT_HIST];
+uint8_t  statHead = 0;                   // próxima posición a escribir
+uint32_t statSeq  = 0;                   // muestras tomadas
+uint8_t  statUartPct = 0;                // pico de ocupación RX del último segundo
+uint16_t statHeapKB  = 0;
+
+// Latencia extremo a extremo (llegada del '$'/'!' → datagrama UDP enviado).
+// Bucket i: < 64<<i µs (el último junta todo lo que sobra). Sólo TaskOut escribe.
+static const int LAT_BUCKETS = 20;
+std::atomic<uint32_t> latHist[LAT_BUCKETS];
+std::atomic<uint32_t> latMaxUs(0);
+void latRecord(uint32_t rxUs){
+  if(!rxUs) return;
+  uint32_t us = stampUs() - rxUs;
+  int b = (us < 64) ? 0 : 26 - __builtin_clz(us);      // [64,128) → 1, [128,256) → 2 ...
+  if(b >= LAT_BUCKETS) b = LAT_BUCKETS-1;
+  latHist[b].fetch_add(1, std::memory_order_relaxed);
+  if(us > latMaxUs.load(std::memory_order_relaxed)) latMaxUs.store(us, std::memory_order_relaxed);
+}
 
 // ============ LED ============
-void flashLed(uint32_t color){
-  pixels.setPixelColor(0,color);
+// El hot path sólo cuenta el evento (fetch_add, nunca bloquea). TaskLED mira
+// los contadores cada LED_WINDOW_MS y hace un destello del estado dominante:
+// show() (RMT + latch del WS2812) ya no corre en el core que vacía el UART.
+inline void ledEvent(LedEvent e){ ledEvents[e].fetch_add(1, std::memory_order_relaxed); }
+
+static void ledShow(uint32_t color){
+  int64_t t0 = esp_timer_get_time();
+  pixels.setPixelColor(0, color);
   pixels.show();
-  ledOn = true;
-  ledMillis = millis();
+  ledShowUs.fetch_add((uint32_t)(esp_timer_get_time() - t0), std::memory_order_relaxed);
+  ledShows.fetch_add(1, std::memory_order_relaxed);
 }
-void updateLed(){
-  if(ledOn && millis()-ledMillis>=LED_DURATION){
-    pixels.setPixelColor(0,0);
-    pixels.show();
-    ledOn=false;
-  }
+
+// ============ Catálogo de sentencias ============
+// Una sola tabla (constexpr, en flash) manda en el generador, en las opciones
+// del <select> (GET /sentences) y en el clasificador: no pueden desalinearse.
+// Cada plantilla guarda la sentencia sin "*hh" y su checksum ya calculado:
+// generar una es buscar + memcpy.
+static constexpr uint8_t nmeaXor(const char* s){ uint8_t cs = 0; while(*s) cs ^= (uint8_t)*s++; return cs; }
+static constexpr uint32_t fmtKey(char a, char b, char c){ return ((uint32_t)a<<16) | ((uint32_t)b<<8) | (uint32_t)c; }
+struct SentenceDef {
+  const char* sensor;      // sensors[].name
+  const char* code;        // valor del <select>: formatter ("RMC") o, en AIS, talker+formatter
+  const char* body;        // "$GPRMC,..." sin "*hh"
+  uint8_t     len;         // strlen(body)
+  uint8_t     cs;          // XOR de body+1
+  uint32_t    fmt;         // formatter para clasificar ('$' nada más; 0 en '!')
+};
+#define NMEA_DEF(sensor, code, body) \
+  { sensor, code, body, (uint8_t)(sizeof(body)-1), nmeaXor(body+1), (body)[0]=='$' ? fmtKey((body)[3],(body)[4],(body)[5]) : 0 }
+static constexpr SentenceDef SENTENCES[] = {
+  NMEA_DEF("GPS", "GLL", "$GPGLL,4916.45,N,12311.12,W,225444,A"),
+  NMEA_DEF("GPS", "RMC", "$GPRMC,123519,A,4807.038,N,01131.000,E,5.5,054.7,230394,003.1,W"),
+  NMEA_DEF("GPS", "VTG", "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K"),
+  NMEA_DEF("GPS", "GGA", "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,"),
+  NMEA_DEF("GPS", "GSA", "$GPGSA,A,3,04,05,09,12,24,25,29,31,,,,,2.5,1.3,2.1"),
+  NMEA_DEF("GPS", "GSV", "$GPGSV,2,1,08,01,40,083,41,02,17,308,43,12,07,021,42,14,25,110,45"),
+  NMEA_DEF("GPS", "DTM", "$GPDTM,W84,,0.0,N,0.0,E,0.0,W84"),
+  NMEA_DEF("GPS", "ZDA", "$GPZDA,201530.00,04,07,2002,00,00"),
+  NMEA_DEF("GPS", "GNS", "$GNGNS,123519,4807.038,N,01131.000,E,AN,08,0.9,545.4,46.9,,"),
+  NMEA_DEF("GPS", "GST", "$GPGST,123519,1.2,1.0,0.8,45.0,0.5,0.5,1.0"),
+  NMEA_DEF("GPS", "GBS", "$GPGBS,123519,0.5,0.5,0.8,01,0.75,0.00,1.00"),
+  NMEA_DEF("GPS", "GRS", "$GPGRS,123519,1,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0"),
+  NMEA_DEF("GPS", "RMB", "$GPRMB,A,0.66,L,ORIG,DEST,4916.45,N,12311.12,W,12.3,054.7,5.5,V"),
+  NMEA_DEF("GPS", "RTE", "$GPRTE,1,1,c,ROUTE1,WP1,WP2,WP3"),
+  NMEA_DEF("GPS", "BOD", "$GPBOD,045.0,T,023.0,M,DEST,ORIG"),
+  NMEA_DEF("GPS", "XTE", "$GPXTE,A,A,0.66,L,N"),
+
+  NMEA_DEF("WEATHER", "MWD", "$IIMWD,054.7,T,034.4,M,10.5,N,5.4,M"),
+  NMEA_DEF("WEATHER", "MWV", "$IIMWV,054.7,R,10.5,N,A"),
+  NMEA_DEF("WEATHER", "VWR", "$IIVWR,054.7,R,10.5,N,5.4,M,19.4,K"),
+  NMEA_DEF("WEATHER", "VWT", "$IIVWT,054.7,T,10.5,N,5.4,M,19.4,K"),
+  NMEA_DEF("WEATHER", "MTW", "$IIMTW,18.0,C"),
+  NMEA_DEF("WEATHER", "MTA", "$IIMTA,19.5,C"),
+  NMEA_DEF("WEATHER", "MMB", "$IIMMB,29.92,I"),
+  NMEA_DEF("WEATHER", "MHU", "$IIMHU,45.0,P"),
+  NMEA_DEF("WEATHER", "MDA", "$IIMDA,29.92,I,1.013,B,19.5,C,18.0,C,,"),
+
+  NMEA_DEF("HEADING", "HDG", "$HCHDG,238.5,,E,0.5"),
+  NMEA_DEF("HEADING", "HDT", "$HCHDT,238.5,T"),
+  NMEA_DEF("HEADING", "HDM", "$HCHDM,236.9,M"),
+  NMEA_DEF("HEADING", "THS", "$HCTHS,238.5,A"),
+  NMEA_DEF("HEADING", "ROT", "$HCROT,0.0,A"),
+  NMEA_DEF("HEADING", "RSA", "$HCRSA,0.0,A,0.0,A"),
+
+  NMEA_DEF("SOUNDER", "DBT", "$SDDBT,036.4,f,011.1,M,006.0,F"),
+  NMEA_DEF("SOUNDER", "DPT", "$SDDPT,11.2,0.5"),
+  NMEA_DEF("SOUNDER", "DBK", "$SDDBK,036.4,f,011.1,M,006.0,F"),
+  NMEA_DEF("SOUNDER", "DBS", "$SDDBS,036.4,f,011.1,M,006.0,F"),
+
+  NMEA_DEF("VELOCITY", "VHW", "$IIVHW,054.7,T,034.4,M,5.5,N,10.2,K"),
+  NMEA_DEF("VELOCITY", "VLW", "$IIVLW,12.4,N,0.5,N"),
+  NMEA_DEF("VELOCITY", "VBW", "$IIVBW,5.5,0.1,0.0,5.3,0.1,0.0"),
+
+  NMEA_DEF("RADAR", "TLL", "$IITLL,1,4916.45,N,12311.12,W,225444,TGT1"),
+  NMEA_DEF("RADAR", "TTM", "$IITTM,1,2.5,N,054.7,T,0.0,N,054.7,T,0.0,54.7,TGT1"),
+  NMEA_DEF("RADAR", "TLB", "$IITLB,1,LOCK,4916.45,N,12311.12,W,225444"),
+  NMEA_DEF("RADAR", "OSD", "$IIOSD,054.7,A,5.5,N,10.2,K"),
+
+  NMEA_DEF("TRANSDUCER", "XDR", "$IIXDR,C,19.5,C,AirTemp"),
+
+  NMEA_DEF("AIS", "AIVDM", "!AIVDM,1,1,,A,13aG?P0P00PD;88MD5MT?wvl0<0,0"),
+  NMEA_DEF("AIS", "AIVDO", "!AIVDO,1,1,,A,13aG?P0P00PD;88MD5MT?wvl0<0,0"),
+};
+#undef NMEA_DEF
+static constexpr int SENTENCE_COUNT = sizeof(SENTENCES)/sizeof(SENTENCES[0]);
+static constexpr bool sentencesFit(){
+  for(const SentenceDef& d : SENTENCES) if(d.len + 3 >= GEN_TEXT_LEN) return false;
+  return true;
+}
+static_assert(sentencesFit(), "plantilla más larga que un slot del generador");
+static_assert(SENTENCES[1].cs == 0x60, "checksum de $GPRMC de referencia");
+
+// Plantilla por sensor + código del <select> (nullptr si no hay)
+static const SentenceDef* sentenceFind(const char* sensor, const char* code){
+  for(const SentenceDef& d : SENTENCES)
+    if(!strcmp(d.sensor, sensor) && !strcasecmp(d.code, code)) return &d;
+  return nullptr;
+}
+// Sensor por formatter ("RMC" → "GPS"), sin importar el talker; nullptr si no está
+static const char* sentenceSensorByFmt(uint32_t fmt){
+  for(const SentenceDef& d : SENTENCES) if(d.fmt == fmt) return d.sensor;
+  return nullptr;
+}
+// "<body>*hh" en out (≥ d.len+4); devuelve el largo
+static size_t sentenceWrite(const SentenceDef& d, char* out){
+  static const char HEXD[] = "0123456789ABCDEF";
+  memcpy(out, d.body, d.len);
+  out[d.len]   = '*';
+  out[d.len+1] = HEXD[d.cs >> 4];
+  out[d.len+2] = HEXD[d.cs & 15];
+  out[d.len+3] = 0;
+  return d.len + 3;
 }
 
 // ============ NMEA helpers ============
@@ -161,15 +609,8 @@ bool processNMEA(const String &line){ return (line.startsWith("$")||line.startsW
 String detectSentenceType(const String &line){
   if (line.startsWith("!")) return "AIS";
   if (line.length()>=6 && line[0]=='$'){
-    String f = line.substring(3,6); f.toUpperCase();
-    if (f=="GLL"||f=="RMC"||f=="VTG"||f=="GGA"||f=="GSA"||f=="GSV"||f=="DTM"||f=="ZDA"||
-        f=="GNS"||f=="GST"||f=="GBS"||f=="GRS"||f=="RMB"||f=="RTE"||f=="BOD"||f=="XTE") return "GPS";
-    if (f=="DBT"||f=="DPT"||f=="DBK"||f=="DBS") return "SOUNDER";
-    if (f=="MWD"||f=="MWV"||f=="VWR"||f=="VWT"||f=="MTW"||f=="MTA"||f=="MMB"||f=="MHU"||f=="MDA") return "WEATHER";
-    if (f=="HDG"||f=="HDT"||f=="HDM"||f=="THS"||f=="ROT"||f=="RSA") return "HEADING";
-    if (f=="VHW"||f=="VLW"||f=="VBW") return "VELOCITY";
-    if (f=="TLL"||f=="TTM"||f=="TLB"||f=="OSD") return "RADAR";
-    if (f=="XDR") return "TRANSDUCER";
+    const char* s = sentenceSensorByFmt(fmtKey(toupper(line[3]), toupper(line[4]), toupper(line[5])));
+    if (s) return s;
   }
   return "OTROS";
 }
@@ -177,19 +618,122 @@ int sensorIndexByName(const String& n){
   for(int i=0;i<SENSOR_COUNT;i++) if(n.equalsIgnoreCase(sensors[i].name)) return i;
   return -1;
 }
-void stampSeen(const String& cat){
-  int idx = sensorIndexByName(cat);
-  if(idx>=0) sensors[idx].lastSeenMs = millis();
+
+// "$GPRMC,..." → clave de "GPRMC" (0 si el ID no es alfanumérico)
+static uint32_t streamKey(const String& s){
+  if(s.length() < 6) return 0;
+  uint32_t k = 0;
+  for(int i=5;i>=1;i--){
+    char c = s[i];
+    uint32_t d;
+    if(c>='0' && c<='9')      d = 1 + (c-'0');
+    else if(c>='A' && c<='Z') d = 11 + (c-'A');
+    else return 0;
+    k = k*37 + d;
+  }
+  return k;
 }
-void stampGen(const String& cat){
-  int idx = sensorIndexByName(cat);
-  if(idx>=0) sensors[idx].lastGenMs = millis();
+// Hot path: categoría + ID, un par de stores relajados por sentencia.
+// Devuelve el índice en streams[] (-1 si no tiene ID o la tabla está llena).
+int stampSeen(const String& sentence, int cat, uint32_t now){
+  if(cat>=0) rateStamp(sensors[cat].rx, now);
+  uint32_t k = streamKey(sentence);
+  if(!k) return -1;
+  for(int n=0, i=k%STREAM_MAX; n<STREAM_MAX; n++, i=(i+1)%STREAM_MAX){
+    uint32_t cur = streams[i].key.load(std::memory_order_relaxed);
+    if(cur==k){ rateStamp(streams[i].rx, now); return i; }
+    if(cur==0){
+      StreamStat& e = streams[i];
+      memcpy(e.id, sentence.c_str()+1, 5); e.id[5] = 0;
+      e.cat = (int8_t)cat;
+      e.ruleGen = 0;                     // resolver regla en el primer outputsFor()
+      rateStamp(e.rx, now);
+      e.key.store(k, std::memory_order_release);
+      return i;
+    }
+  }
+  streamOverflow.fetch_add(1, std::memory_order_relaxed);
+  return -1;
 }
 
-void sendUDP(const String &line){
-  udp.beginPacket(udpAddress, udpPort);
-  udp.print(line);
-  udp.endPacket();
+void tcpBegin(){
+  tcpServer.onClient([](void*, AsyncClient* c){
+    xSemaphoreTake(tcpMutex,portMAX_DELAY);
+    int slot=-1;
+    for(int i=0;i<TCP_MAX_CLIENTS;i++) if(!tcpClients[i]){ slot=i; break; }
+    if(slot>=0){ tcpClients[slot]=c; tcpClientCount++; }
+    xSemaphoreGive(tcpMutex);
+    if(slot<0){ c->close(true); delete c; return; }
+    c->setNoDelay(true);
+    c->onDisconnect([](void*, AsyncClient* c){
+      xSemaphoreTake(tcpMutex,portMAX_DELAY);
+      for(int i=0;i<TCP_MAX_CLIENTS;i++) if(tcpClients[i]==c){ tcpClients[i]=nullptr; tcpClientCount--; }
+      xSemaphoreGive(tcpMutex);
+      delete c;
+    });
+  }, nullptr);
+  tcpServer.begin();
+}
+
+// ============ Filtros por salida ============
+// "GSV" coincide con cualquier talker; "GPGSV" sólo con ese ID
+static bool ruleMatches(const IdRule& r, const char* id){
+  if(!r.id[0]) return false;
+  return (strlen(r.id)==3) ? strncmp(r.id, id+2, 3)==0 : strncmp(r.id, id, 5)==0;
+}
+static void resolveRule(StreamStat& e, uint32_t gen){
+  uint8_t drop=0; uint16_t minMs=0;
+  for(int i=0;i<ID_RULE_MAX;i++){
+    if(ruleMatches(idRules[i], e.id)){ drop=idRules[i].drop; minMs=idRules[i].minMs; break; }
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);             // las lecturas de idRules[] no pasan la revalidación
+  if(idRulesGen.load(std::memory_order_relaxed) != gen) return;   // cambió en el medio: reintentar luego
+  e.drop = drop; e.minMs = minMs; e.ruleGen = gen;
+}
+
+// ============ Deduplicación ============
+// FNV-1a del cuerpo (entre '$'/'!' y '*'): el checksum no aporta nada
+static uint32_t bodyHash(const String& s){
+  uint32_t h=2166136261u;
+  for(size_t i=1;i<s.length() && s[i]!='*';i++){ h^=(uint8_t)s[i]; h*=16777619u; }
+  return h;
+}
+// true → igual a la anterior del mismo ID, llegó dentro de la ventana y el keep-alive no venció
+bool isDuplicate(StreamStat& e, const String& s, uint32_t now){
+  uint32_t h = bodyHash(s);
+  bool dup = (e.lastEmitMs != 0) && (h == e.lastHash)
+          && (now - e.lastArrivalMs <= dedupWindowMs)
+          && (now - e.lastEmitMs    <  dedupKeepAliveMs);
+  e.lastHash = h;
+  e.lastArrivalMs = now;
+  if(dup){
+    e.suppressed.fetch_add(1, std::memory_order_relaxed);
+    statDedup.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  e.lastEmitMs = now;
+  return false;
+}
+
+// Bitmask de salidas (OUT_BIT) por las que debe salir esta sentencia
+uint8_t outputsFor(int cat, int si, uint32_t now){
+  const uint16_t bit = 1u << ((cat>=0) ? SENSOR_FILTER_BIT[cat] : FILTER_OTROS);
+  uint8_t outs = 0;
+  for(int o=0;o<OUT_COUNT;o++) if(outCatMask[o] & bit) outs |= OUT_BIT(o);
+  if(si<0 || !outs) return outs;
+
+  StreamStat& e = streams[si];
+  uint32_t gen = idRulesGen.load(std::memory_order_acquire);
+  if(e.ruleGen != gen && !(gen & 1)) resolveRule(e, gen);
+  outs &= ~e.drop;
+  if(e.minMs){
+    for(int o=0;o<OUT_COUNT;o++){
+      if(!(outs & OUT_BIT(o))) continue;
+      if(now - e.lastOutMs[o] < e.minMs) outs &= ~OUT_BIT(o);
+      else e.lastOutMs[o] = now;
+    }
+  }
+  return outs;
 }
 
 // ============ Builders / checksum ============
@@ -197,105 +741,36 @@ String nmeaChecksum(const String &payload){
   uint8_t cs=0; for(size_t i=0;i<payload.length();i++) cs^=(uint8_t)payload[i];
   char b[3]; snprintf(b,sizeof(b),"%02X",cs); return String(b);
 }
-String buildDollarSentence(const String& talker,const String& code,const String& fields){
-  String payload = talker+code+","+fields;
-  return "$"+payload+"*"+nmeaChecksum(payload);
-}
-String buildAISSentence_VDM(){
-  String p="AIVDM,1,1,,A,13aG?P0P00PD;88MD5MT?wvl0<0,0";
-  return "!"+p+"*"+nmeaChecksum(p);
-}
-String buildAISSentence_VDO(){
-  String p="AIVDO,1,1,,A,13aG?P0P00PD;88MD5MT?wvl0<0,0";
-  return "!"+p+"*"+nmeaChecksum(p);
-}
-String talkerForSensor(const String& s){
-  if (s=="GPS") return "GP";
-  if (s=="AIS") return "AI";
-  if (s=="SOUNDER") return "SD";
-  if (s=="HEADING") return "HC";
-  if (s=="CUSTOM") return "";
-  return "II"; // WEATHER / VELOCITY / RADAR / TRANSDUCER
+// Plantilla del catálogo en out (≥ GEN_TEXT_LEN+4); 0 = CUSTOM (sin plantilla).
+// Un código que no está en la tabla (config vieja) sale sin campos con el talker del sensor.
+size_t sentenceRender(const char* sensor, const char* code, char* out){
+  if(!strcasecmp(sensor,"CUSTOM") || !strcasecmp(code,"CUSTOM")) return 0;
+  if(const SentenceDef* d = sentenceFind(sensor, code)) return sentenceWrite(*d, out);
+  const char* talker = "II";
+  for(const SentenceDef& d : SENTENCES){
+    if(strcmp(d.sensor, sensor)) continue;
+    if(d.body[0]=='!') return sentenceWrite(d, out);        // AIS: VDM
+    talker = d.body+1;
+    break;
+  }
+  int n = snprintf(out, GEN_TEXT_LEN, "$%.2s%.8s,", talker, code);
+  for(int i=3;i<n;i++) out[i] = toupper(out[i]);
+  return n + snprintf(out+n, 4, "*%02X", nmeaXor(out+1));
 }
 String generateSentence(const String& sensor,const String& codeIn){
-  if (sensor.equalsIgnoreCase("CUSTOM")||codeIn.equalsIgnoreCase("CUSTOM")) return "";
-  String c=codeIn; c.toUpperCase();
-  String t=talkerForSensor(sensor);
-
-  if(sensor=="AIS"){ if(c=="AIVDO") return buildAISSentence_VDO(); return buildAISSentence_VDM(); }
-
-  // GPS
-  if(sensor=="GPS"){
-    if(c=="RMC") return buildDollarSentence("GP",c,"123519,A,4807.038,N,01131.000,E,5.5,054.7,230394,003.1,W");
-    if(c=="GGA") return buildDollarSentence("GP",c,"123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,");
-    if(c=="GLL") return buildDollarSentence("GP",c,"4916.45,N,12311.12,W,225444,A");
-    if(c=="VTG") return buildDollarSentence("GP",c,"054.7,T,034.4,M,005.5,N,010.2,K");
-    if(c=="GSA") return buildDollarSentence("GP",c,"A,3,04,05,09,12,24,25,29,31,,,,,2.5,1.3,2.1");
-    if(c=="GSV") return buildDollarSentence("GP",c,"2,1,08,01,40,083,41,02,17,308,43,12,07,021,42,14,25,110,45");
-    if(c=="DTM") return buildDollarSentence("GP",c,"W84,,0.0,N,0.0,E,0.0,W84");
-    if(c=="ZDA") return buildDollarSentence("GP",c,"201530.00,04,07,2002,00,00");
-    if(c=="GNS") return buildDollarSentence("GN",c,"123519,4807.038,N,01131.000,E,AN,08,0.9,545.4,46.9,,");
-    if(c=="GST") return buildDollarSentence("GP",c,"123519,1.2,1.0,0.8,45.0,0.5,0.5,1.0");
-    if(c=="GBS") return buildDollarSentence("GP",c,"123519,0.5,0.5,0.8,01,0.75,0.00,1.00");
-    if(c=="GRS") return buildDollarSentence("GP",c,"123519,1,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0");
-    if(c=="RMB") return buildDollarSentence("GP",c,"A,0.66,L,ORIG,DEST,4916.45,N,12311.12,W,12.3,054.7,5.5,V");
-    if(c=="RTE") return buildDollarSentence("GP",c,"1,1,c,ROUTE1,WP1,WP2,WP3");
-    if(c=="BOD") return buildDollarSentence("GP",c,"045.0,T,023.0,M,DEST,ORIG");
-    if(c=="XTE") return buildDollarSentence("GP",c,"A,A,0.66,L,N");
-  }
-
-  // WEATHER
-  if(t=="II" && c=="MWD") return buildDollarSentence(t,c,"054.7,T,034.4,M,10.5,N,5.4,M");
-  if(t=="II" && c=="MWV") return buildDollarSentence(t,c,"054.7,R,10.5,N,A");
-  if(t=="II" && c=="VWR") return buildDollarSentence(t,c,"054.7,R,10.5,N,5.4,M,19.4,K");
-  if(t=="II" && c=="VWT") return buildDollarSentence(t,c,"054.7,T,10.5,N,5.4,M,19.4,K");
-  if(t=="II" && c=="MTW") return buildDollarSentence(t,c,"18.0,C");
-  if(t=="II" && c=="MTA") return buildDollarSentence(t,c,"19.5,C");
-  if(t=="II" && c=="MMB") return buildDollarSentence(t,c,"29.92,I");
-  if(t=="II" && c=="MHU") return buildDollarSentence(t,c,"45.0,P");
-  if(t=="II" && c=="MDA") return buildDollarSentence(t,c,"29.92,I,1.013,B,19.5,C,18.0,C,,");
-
-  // HEADING
-  if(t=="HC" && c=="HDG") return buildDollarSentence(t,c,"238.5,,E,0.5");
-  if(t=="HC" && c=="HDT") return buildDollarSentence(t,c,"238.5,T");
-  if(t=="HC" && c=="HDM") return buildDollarSentence(t,c,"236.9,M");
-  if(t=="HC" && c=="THS") return buildDollarSentence(t,c,"238.5,A");
-  if(t=="HC" && c=="ROT") return buildDollarSentence(t,c,"0.0,A");
-  if(t=="HC" && c=="RSA") return buildDollarSentence(t,c,"0.0,A,0.0,A");
-
-  // SOUNDER
-  if(t=="SD" && c=="DBT") return buildDollarSentence(t,c,"036.4,f,011.1,M,006.0,F");
-  if(t=="SD" && c=="DPT") return buildDollarSentence(t,c,"11.2,0.5");
-  if(t=="SD" && c=="DBK") return buildDollarSentence(t,c,"036.4,f,011.1,M,006.0,F");
-  if(t=="SD" && c=="DBS") return buildDollarSentence(t,c,"036.4,f,011.1,M,006.0,F");
-
-  // VELOCITY
-  if(t=="II" && c=="VHW") return buildDollarSentence(t,c,"054.7,T,034.4,M,5.5,N,10.2,K");
-  if(t=="II" && c=="VLW") return buildDollarSentence(t,c,"12.4,N,0.5,N");
-  if(t=="II" && c=="VBW") return buildDollarSentence(t,c,"5.5,0.1,0.0,5.3,0.1,0.0");
-
-  // RADAR
-  if(t=="II" && c=="TLL") return buildDollarSentence(t,c,"1,4916.45,N,12311.12,W,225444,TGT1");
-  if(t=="II" && c=="TTM") return buildDollarSentence(t,c,"1,2.5,N,054.7,T,0.0,N,054.7,T,0.0,54.7,TGT1");
-  if(t=="II" && c=="TLB") return buildDollarSentence(t,c,"1,LOCK,4916.45,N,12311.12,W,225444");
-  if(t=="II" && c=="OSD") return buildDollarSentence(t,c,"054.7,A,5.5,N,10.2,K");
-
-  // TRANSDUCER
-  if(t=="II" && c=="XDR") return buildDollarSentence(t,c,"C,19.5,C,AirTemp");
-
-  return buildDollarSentence(t,c,"");
-}
-
-// ============ HTML utils ============
-String htmlEscape(const String& s){
+  char b[GEN_TEXT_LEN+4];
+  size_t n = sentenceRender(sensor.c_str(), codeIn.c_str(), b);
+  return n ? String(b) : String();
+}
+
+// ============ HTML/JSON utils ============
+String jsonEscape(const String& s){
   String o; o.reserve(s.length()+8);
   for(size_t i=0;i<s.length();++i){
     char c=s[i];
-    if(c=='&') o += F("&amp;");
-    else if(c=='<') o += F("&lt;");
-    else if(c=='>') o += F("&gt;");
-    else if(c=='\"') o += F("&quot;");
-    else if(c=='\'') o += F("&#39;");
+    if(c=='\"') o += F("\\\"");
+    else if(c=='\\') o += F("\\\\");
+    else if((uint8_t)c<0x20){ char b[8]; snprintf(b,sizeof(b),"\\u%04x",(uint8_t)c); o += b; }
     else o += c;
   } return o;
 }
@@ -310,11 +785,40 @@ String fullToEditable(const String& full){
 }
 void pushGen(const String& line){
   xSemaphoreTake(genBufMutex,portMAX_DELAY);
-  genIndex=(genIndex+1)%GEN_BUFFER_LINES;
-  genBuffer[genIndex]=line;
+  genConsole.push(line);
   xSemaphoreGive(genBufMutex);
 }
 
+// Escritor secuencial sobre un buffer fijo (sin String). Si no entra, trunca y marca overflow.
+struct BufWriter {
+  char*  buf;
+  size_t cap;
+  size_t n = 0;
+  bool   overflow = false;
+  BufWriter(char* b, size_t c) : buf(b), cap(c) { if(cap) buf[0]=0; }
+  void reset(){ n=0; overflow=false; if(cap) buf[0]=0; }
+  void write(const char* s, size_t l){
+    if(n+l >= cap){ overflow=true; l = (cap>n+1) ? cap-n-1 : 0; }
+    memcpy(buf+n, s, l); n+=l; buf[n]=0;
+  }
+  void raw(const char* s){ write(s, strlen(s)); }
+  void printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))){
+    if(n+1 >= cap){ overflow=true; return; }
+    va_list ap; va_start(ap, fmt);
+    int r = vsnprintf(buf+n, cap-n, fmt, ap);
+    va_end(ap);
+    if(r<0) return;
+    if((size_t)r >= cap-n){ overflow=true; n=cap-1; } else n+=r;
+  }
+  // Punto fijo: fixed(-12345, 2) → "-123.45"
+  void fixed(int32_t v, uint8_t dec){
+    uint32_t p=1; for(uint8_t i=0;i<dec;i++) p*=10;
+    uint32_t u = (v<0) ? (uint32_t)(-(int64_t)v) : (uint32_t)v;
+    if(dec) printf("%s%lu.%0*lu", v<0?"-":"", (unsigned long)(u/p), (int)dec, (unsigned long)(u%p));
+    else    printf("%s%lu", v<0?"-":"", (unsigned long)u);
+  }
+};
+
 /* ===========================================================
    SOPORTE IEC61162-450 (UdPbC) + NMEA Tag Block (\ ... \)
    =========================================================== */
@@ -353,6 +857,15 @@ static bool verifyTagChecksum(const String& inner){
   uint8_t cs=0; for(size_t i=0;i<payload.length();++i) cs ^= (uint8_t)payload[i];
   return (cs==want);
 }
+// Checksum de la sentencia ($/!...*hh). Sin '*' no hay nada que verificar.
+static bool nmeaChecksumOk(const String& s){
+  int asterisk = s.lastIndexOf('*');
+  if(asterisk<0) return true;
+  if(asterisk+2 >= (int)s.length()) return false;
+  uint8_t want=0; if(!parseHexByte(s.substring(asterisk+1, asterisk+3), want)) return false;
+  uint8_t cs=0; for(int i=1;i<asterisk;++i) cs ^= (uint8_t)s[i];
+  return (cs==want);
+}
 static void parseTagPairs(const String& inner, String &meta){
   int asterisk = inner.lastIndexOf('*');
   String body = (asterisk>0)? inner.substring(0,asterisk) : inner;
@@ -413,415 +926,1689 @@ static bool parseNMEALine(const String& rawIn, String &outSentence, String &outM
   return true;
 }
 
+// ============ Parser de campos → VesselState ============
+// Tokenizador sin copias: punteros al buffer de la sentencia, hasta '*'.
+// Los decodificadores trabajan en punto fijo (sin toFloat) y la cantidad de
+// campos está acotada → costo por sentencia fijo y medido (parseMaxCycles).
+static const int NMEA_MAX_FIELDS = 24;
+struct NmeaFields {
+  const char* f[NMEA_MAX_FIELDS];
+  uint8_t     len[NMEA_MAX_FIELDS];
+  uint8_t     n;
+};
+static bool nmeaTokenize(const String& s, NmeaFields& t){
+  const char* p = s.c_str();
+  const char* end = p + s.length();
+  if(end - p < 7) return false;
+  p++;                                           // '$' / '!'
+  t.n = 0;
+  const char* start = p;
+  for(;; p++){
+    if(p==end || *p==',' || *p=='*'){
+      if(t.n >= NMEA_MAX_FIELDS) return false;
+      t.f[t.n] = start; t.len[t.n] = (uint8_t)min<size_t>(p - start, 255); t.n++;
+      if(p==end || *p=='*') break;
+      start = p + 1;
+    }
+  }
+  return t.len[0] == 5;                          // "GPRMC"
+}
+// "-12.345" → -12345 con dec=3 (trunca decimales de más). false si vacío/no numérico.
+static bool parseFixed(const char* p, uint8_t len, uint8_t dec, int32_t& out){
+  if(!len) return false;
+  bool neg=false; uint8_t i=0;
+  if(p[0]=='-' || p[0]=='+'){ neg = (p[0]=='-'); i=1; }
+  int64_t v=0; int8_t frac=-1; bool any=false;   // 64 bits: el escalado final no desborda
+  for(; i<len; i++){
+    char c=p[i];
+    if(c=='.'){ if(frac>=0) return false; frac=0; continue; }
+    if(c<'0' || c>'9') return false;
+    if(frac>=0){ if(frac>=dec) continue; frac++; }
+    v = v*10 + (c-'0'); any=true;
+    if(v > INT32_MAX) return false;
+  }
+  if(!any) return false;
+  for(int8_t k=(frac<0?0:frac); k<dec; k++) v*=10;   // dec ≤ 7: ≤ 2^31·1e7, entra en int64
+  if(v > INT32_MAX) return false;                    // fuera de rango con la escala pedida
+  out = neg ? -(int32_t)v : (int32_t)v;
+  return true;
+}
+// "ddmm.mmmmm" + hemisferio → grados ×1e7
+static bool parseLatLon(const char* p, uint8_t len, char hemi, int degDigits, int32_t& out){
+  if(len < (uint8_t)(degDigits+2)) return false;
+  int32_t deg;  if(!parseFixed(p, degDigits, 0, deg)) return false;
+  int32_t min5; if(!parseFixed(p+degDigits, len-degDigits, 5, min5)) return false;   // minutos ×1e5
+  if(deg > (degDigits==2 ? 90 : 180) || min5 < 0 || min5 >= 6000000) return false;   // y así no desborda abajo
+  int32_t v = deg*10000000 + (min5*10)/6;                                              // min/60 ×1e7
+  out = (hemi=='S' || hemi=='W') ? -v : v;
+  return true;
+}
+static inline char fch(const NmeaFields& t, int i){ return (i<t.n && t.len[i]) ? t.f[i][0] : 0; }
+static inline bool fnum(const NmeaFields& t, int i, uint8_t dec, int32_t& out){ return i<t.n && parseFixed(t.f[i], t.len[i], dec, out); }
+
+// Qué datos cambió una sentencia (para emitir deltas)
+enum : uint16_t {
+  VF_POS=1<<0, VF_SOG=1<<1, VF_COG=1<<2, VF_HDG_T=1<<3, VF_HDG_M=1<<4, VF_DEPTH=1<<5,
+  VF_AWIND=1<<6, VF_TWIND=1<<7, VF_WTEMP=1<<8, VF_ATEMP=1<<9, VF_FIX=1<<10, VF_TIME=1<<11,
+};
+
+// Último estado conocido. Unidades: grados ×1e7 / ×100, nudos ×100, metros ×100, °C ×100.
+// Cada dato tiene su marca de tiempo (0 = nunca visto).
+struct VesselState {
+  int32_t  latE7, lonE7;         uint32_t tPos;
+  int32_t  sogKn100;             uint32_t tSog;
+  int32_t  cogDeg100;            uint32_t tCog;
+  int32_t  hdgTrueDeg100;        uint32_t tHdgTrue;
+  int32_t  hdgMagDeg100;         uint32_t tHdgMag;
+  int32_t  depthM100;            uint32_t tDepth;      // bajo el transductor (DBT, DPT campo 1)
+  int32_t  depthOffM100;         uint32_t tDepthOff;   // offset DPT: >0 transductor→superficie, <0 →quilla
+  int32_t  awaDeg100, awsKn100;  uint32_t tAppWind;    // aparente: 0..360 desde proa
+  int32_t  twaDeg100, twsKn100;  uint32_t tTrueWind;
+  int32_t  waterTempC100;        uint32_t tWaterTemp;
+  int32_t  airTempC100;          uint32_t tAirTemp;
+  uint8_t  fixQuality, sats;     int32_t  hdop100;     uint32_t tFix;
+  int32_t  utcTimeCs;            int32_t  dateDdmmyy;  uint32_t tTime;   // hhmmss.ss ×100, ddmmyy
+};
+VesselState vessel;
+// Qué profundidad se muestra: con offset DPT ≠ 0 se corrige a superficie o a quilla
+enum DepthRef : uint8_t { DEPTH_XDR=0, DEPTH_SURFACE, DEPTH_KEEL };
+static const char* const DEPTH_LABEL[] = {"DBT", "DBS", "DBK"};
+static const char* const DEPTH_REF_NAME[] = {"transducer", "surface", "keel"};
+static DepthRef depthRef(const VesselState& v){
+  if(!v.tDepthOff || v.depthOffM100 == 0) return DEPTH_XDR;
+  return v.depthOffM100 > 0 ? DEPTH_SURFACE : DEPTH_KEEL;
+}
+static int32_t depthShownM100(const VesselState& v){
+  return depthRef(v) == DEPTH_XDR ? v.depthM100 : v.depthM100 + v.depthOffM100;
+}
+// Seqlock: sólo TaskProc escribe; los lectores copian y reintentan si cambió
+std::atomic<uint32_t> vesselSeq(0);
+uint32_t parseMaxCycles   = 0;     // peor caso medido (ciclos de CPU)
+uint32_t parseOverBudget  = 0;     // sentencias que superaron PARSE_BUDGET_CYCLES
+std::atomic<uint32_t> parsedCount(0);
+static const uint32_t PARSE_BUDGET_CYCLES = 24000;   // ~100 µs @ 240 MHz
+
+VesselState vesselSnapshot(){
+  VesselState v; uint32_t s0, s1;
+  do {
+    s0 = vesselSeq.load(std::memory_order_acquire);
+    memcpy(&v, &vessel, sizeof(v));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    s1 = vesselSeq.load(std::memory_order_relaxed);
+  } while((s0 & 1) || s0 != s1);
+  return v;
+}
+
+// Velocidad de MWV a nudos ×100 según unidad
+static int32_t toKn100(int32_t v100, char unit){
+  switch(unit){
+    case 'K': return (int32_t)((int64_t)v100 * 5400 / 10000);    // km/h
+    case 'M': return (int32_t)((int64_t)v100 * 19438 / 10000);   // m/s
+    default:  return v100;                                        // N
+  }
+}
+
+static constexpr uint32_t FMT(char a, char b, char c){ return ((uint32_t)a<<16)|((uint32_t)b<<8)|(uint32_t)c; }
+
+// Decodifica la sentencia (ya validada por checksum) sobre 'w'. true si tocó algún dato.
+static bool decodeInto(VesselState& w, const NmeaFields& t, uint32_t now){
+  const char* id = t.f[0];
+  int32_t a, b;
+  switch(FMT(id[2], id[3], id[4])){
+    case FMT('R','M','C'):
+      if(t.n < 10) return false;
+      if(fch(t,1) && fnum(t,1,2,a)){ w.utcTimeCs=a; if(fnum(t,9,0,b)) w.dateDdmmyy=b; w.tTime=now; }
+      if(fch(t,2)!='A') return true;                                   // 'V' = sin fix
+      if(parseLatLon(t.f[3],t.len[3],fch(t,4),2,a) && parseLatLon(t.f[5],t.len[5],fch(t,6),3,b)){ w.latE7=a; w.lonE7=b; w.tPos=now; }
+      if(fnum(t,7,2,a)){ w.sogKn100=a;  w.tSog=now; }
+      if(fnum(t,8,2,a)){ w.cogDeg100=a; w.tCog=now; }
+      return true;
+    case FMT('G','G','A'):
+      if(fnum(t,6,0,a)){ w.fixQuality=(uint8_t)a; if(fnum(t,7,0,b)) w.sats=(uint8_t)b; if(fnum(t,8,2,b)) w.hdop100=b; w.tFix=now; }
+      if(w.fixQuality && t.n>5 && parseLatLon(t.f[2],t.len[2],fch(t,3),2,a) && parseLatLon(t.f[4],t.len[4],fch(t,5),3,b)){ w.latE7=a; w.lonE7=b; w.tPos=now; }
+      return true;
+    case FMT('G','L','L'):
+      if(fch(t,6)=='A' && t.n>4 && parseLatLon(t.f[1],t.len[1],fch(t,2),2,a) && parseLatLon(t.f[3],t.len[3],fch(t,4),3,b)){ w.latE7=a; w.lonE7=b; w.tPos=now; }
+      return true;
+    case FMT('V','T','G'):
+      if(fnum(t,1,2,a)){ w.cogDeg100=a; w.tCog=now; }
+      if(fnum(t,5,2,a)){ w.sogKn100=a;  w.tSog=now; }
+      return true;
+    case FMT('H','D','T'):
+      if(fnum(t,1,2,a)){ w.hdgTrueDeg100=a; w.tHdgTrue=now; }
+      return true;
+    case FMT('H','D','M'):
+      if(fnum(t,1,2,a)){ w.hdgMagDeg100=a; w.tHdgMag=now; }
+      return true;
+    case FMT('H','D','G'):                                             // sensor + desvío + variación
+      if(fnum(t,1,2,a)){
+        if(fnum(t,2,2,b)) a += (fch(t,3)=='W') ? -b : b;
+        w.hdgMagDeg100=(a+36000)%36000; w.tHdgMag=now;
+        if(fnum(t,4,2,b)){ a += (fch(t,5)=='W') ? -b : b; w.hdgTrueDeg100=(a+36000)%36000; w.tHdgTrue=now; }
+      }
+      return true;
+    case FMT('T','H','S'):
+      if(fch(t,2)=='A' && fnum(t,1,2,a)){ w.hdgTrueDeg100=a; w.tHdgTrue=now; }
+      return true;
+    case FMT('D','P','T'):
+      if(fnum(t,1,2,a)){
+        w.depthM100=a; w.tDepth=now;
+        w.depthOffM100 = fnum(t,2,2,b) ? b : 0; w.tDepthOff=now;   // DBT no trae offset: conserva el último
+      }
+      return true;
+    case FMT('D','B','T'):
+      if(fnum(t,3,2,a)){ w.depthM100=a; w.tDepth=now; }
+      return true;
+    case FMT('M','W','V'):
+      if(fch(t,5)!='A' || !fnum(t,1,2,a) || !fnum(t,3,2,b)) return false;
+      b = toKn100(b, fch(t,4));
+      if(fch(t,2)=='T'){ w.twaDeg100=a; w.twsKn100=b; w.tTrueWind=now; }
+      else             { w.awaDeg100=a; w.awsKn100=b; w.tAppWind=now; }
+      return true;
+    case FMT('M','T','W'):
+      if(fnum(t,1,2,a)){ w.waterTempC100=a; w.tWaterTemp=now; }
+      return true;
+    case FMT('X','D','R'):                                             // primer transductor de temperatura
+      for(int i=1; i+3<t.n; i+=4){
+        if(fch(t,i)=='C' && fch(t,i+2)=='C' && fnum(t,i+1,2,a)){ w.airTempC100=a; w.tAirTemp=now; return true; }
+      }
+      return false;
+  }
+  return false;
+}
+
+static uint16_t changedFields(const VesselState& a, const VesselState& b){
+  uint16_t m = 0;
+  if(a.tPos!=b.tPos)             m|=VF_POS;
+  if(a.tSog!=b.tSog)             m|=VF_SOG;
+  if(a.tCog!=b.tCog)             m|=VF_COG;
+  if(a.tHdgTrue!=b.tHdgTrue)     m|=VF_HDG_T;
+  if(a.tHdgMag!=b.tHdgMag)       m|=VF_HDG_M;
+  if(a.tDepth!=b.tDepth || a.tDepthOff!=b.tDepthOff) m|=VF_DEPTH;
+  if(a.tAppWind!=b.tAppWind)     m|=VF_AWIND;
+  if(a.tTrueWind!=b.tTrueWind)   m|=VF_TWIND;
+  if(a.tWaterTemp!=b.tWaterTemp) m|=VF_WTEMP;
+  if(a.tAirTemp!=b.tAirTemp)     m|=VF_ATEMP;
+  if(a.tFix!=b.tFix)             m|=VF_FIX;
+  if(a.tTime!=b.tTime)           m|=VF_TIME;
+  return m;
+}
+
+// Hot path (TaskProc). Sólo sentencias con checksum OK. Devuelve VF_* cambiados.
+uint16_t parseVessel(const String& s, uint32_t now){
+  uint32_t c0 = ESP.getCycleCount();
+  NmeaFields t;
+  uint16_t touched = 0;
+  if(s[0]=='$' && nmeaTokenize(s, t)){
+    VesselState w = vessel;                      // decodificar sobre copia: el seqlock queda abierto lo mínimo
+    if(decodeInto(w, t, now)){
+      touched = changedFields(vessel, w);
+      uint32_t q = vesselSeq.load(std::memory_order_relaxed);
+      vesselSeq.store(q+1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      vessel = w;
+      vesselSeq.store(q+2, std::memory_order_release);
+      parsedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  uint32_t dc = ESP.getCycleCount() - c0;
+  if(dc > parseMaxCycles) parseMaxCycles = dc;
+  if(dc > PARSE_BUDGET_CYCLES) parseOverBudget++;
+  return touched;
+}
+
+// ============ Signal K (deltas) ============
+// TaskProc acumula los VF_* cambiados y TaskOut cada SK_BATCH_MS arma UN delta con
+// todos ellos, en un buffer estático (BufWriter), para WebSocket y/o UDP.
+// El 0183 crudo sigue saliendo en paralelo por UDP/TCP 10110.
+const uint32_t SK_BATCH_MS = 100;
+static char     skBuf[1280];            // peor caso (todas las rutas) ≈ 1 KB
+static std::atomic<uint16_t> skDirty(0);
+static uint32_t skLastFlush = 0;
+std::atomic<uint32_t> skDeltas(0);
+std::atomic<uint32_t> skDrops(0);        // deltas no enviados por WS saturado
+
+static const float KN_TO_MS  = 0.514444f;
+static const float DEG_TO_RAD = 0.01745329252f;
+
+static void skValue(BufWriter& w, bool& first, const char* path){
+  w.raw(first ? "" : ",");
+  first = false;
+  w.printf("{\"path\":\"%s\",\"value\":", path);
+}
+static void skNum(BufWriter& w, bool& first, const char* path, float v, uint8_t dec){
+  skValue(w, first, path);
+  w.printf("%.*f}", dec, v);
+}
+// Ángulo relativo a proa: 0..360 → -π..π (babor negativo)
+static float skRelAngle(int32_t deg100){
+  float d = deg100/100.0f;
+  if(d > 180.0f) d -= 360.0f;
+  return d * DEG_TO_RAD;
+}
+
+// Serializa las rutas de 'mask' (unidades SI). Devuelve largo o 0 si no hubo nada.
+size_t skBuildDelta(BufWriter& w, const VesselState& v, uint16_t mask, uint32_t now){
+  w.reset();
+  w.raw("{\"updates\":[{\"source\":{\"label\":\"nmealink\",\"type\":\"NMEA0183\"}");
+  if(v.tTime && v.dateDdmmyy && now - v.tTime < 2000){
+    long t = v.utcTimeCs, d = v.dateDdmmyy, yy = d%100;
+    w.printf(",\"timestamp\":\"%04ld-%02ld-%02ldT%02ld:%02ld:%02ld.%02ldZ\"",
+             yy + (yy<80 ? 2000 : 1900), (d/100)%100, d/10000, t/1000000, (t/10000)%100, (t/100)%100, t%100);
+  }
+  w.raw(",\"values\":[");
+  bool first = true;
+  if(mask & VF_POS){
+    skValue(w, first, "navigation.position");
+    w.raw("{\"latitude\":"); w.fixed(v.latE7, 7); w.raw(",\"longitude\":"); w.fixed(v.lonE7, 7); w.raw("}}");
+  }
+  if(mask & VF_SOG)   skNum(w, first, "navigation.speedOverGround",      v.sogKn100/100.0f*KN_TO_MS, 3);
+  if(mask & VF_COG)   skNum(w, first, "navigation.courseOverGroundTrue", v.cogDeg100/100.0f*DEG_TO_RAD, 4);
+  if(mask & VF_HDG_T) skNum(w, first, "navigation.headingTrue",          v.hdgTrueDeg100/100.0f*DEG_TO_RAD, 4);
+  if(mask & VF_HDG_M) skNum(w, first, "navigation.headingMagnetic",      v.hdgMagDeg100/100.0f*DEG_TO_RAD, 4);
+  if(mask & VF_DEPTH){
+    skNum(w, first, "environment.depth.belowTransducer", v.depthM100/100.0f, 2);
+    DepthRef ref = depthRef(v);
+    if(ref != DEPTH_XDR)
+      skNum(w, first, ref == DEPTH_SURFACE ? "environment.depth.belowSurface" : "environment.depth.belowKeel",
+            depthShownM100(v)/100.0f, 2);
+  }
+  if(mask & VF_AWIND){
+    skNum(w, first, "environment.wind.angleApparent", skRelAngle(v.awaDeg100), 4);
+    skNum(w, first, "environment.wind.speedApparent", v.awsKn100/100.0f*KN_TO_MS, 2);
+  }
+  if(mask & VF_TWIND){
+    skNum(w, first, "environment.wind.angleTrueWater", skRelAngle(v.twaDeg100), 4);
+    skNum(w, first, "environment.wind.speedTrue",      v.twsKn100/100.0f*KN_TO_MS, 2);
+  }
+  if(mask & VF_WTEMP) skNum(w, first, "environment.water.temperature",   v.waterTempC100/100.0f + 273.15f, 2);
+  if(mask & VF_ATEMP) skNum(w, first, "environment.outside.temperature", v.airTempC100/100.0f + 273.15f, 2);
+  if(mask & VF_FIX){
+    skNum(w, first, "navigation.gnss.satellites",         v.sats, 0);
+    skNum(w, first, "navigation.gnss.horizontalDilution", v.hdop100/100.0f, 2);
+  }
+  if(first) return 0;
+  w.raw("]}]}");
+  return w.overflow ? 0 : w.n;
+}
+
+// TaskOut
+void skFlushIfDue(uint32_t now){
+  if(!skDirty.load(std::memory_order_relaxed) || now - skLastFlush < SK_BATCH_MS) return;
+  bool ws  = cfgSkWs  && skWs.count();
+  bool udpOut = cfgSkUdp && netReady;
+  uint16_t mask = skDirty.exchange(0, std::memory_order_relaxed);
+  skLastFlush = now;
+  if(!ws && !udpOut) return;
+
+  BufWriter w(skBuf, sizeof(skBuf));
+  size_t len = skBuildDelta(w, vesselSnapshot(), mask, now);
+  if(!len) return;
+  skDeltas.fetch_add(1, std::memory_order_relaxed);
+  if(ws){
+    if(skWs.availableForWriteAll()) skWs.textAll(skBuf, len);
+    else skDrops.fetch_add(1, std::memory_order_relaxed);
+  }
+  if(udpOut){
+    udp.beginPacket(udpAddress, SK_UDP_PORT);
+    udp.write((const uint8_t*)skBuf, len);
+    udp.endPacket();
+  }
+}
+
+// Mensaje "hello" al conectar (lo esperan los clientes Signal K)
+void skOnEvent(AsyncWebSocket*, AsyncWebSocketClient* c, AwsEventType type, void*, uint8_t*, size_t){
+  if(type != WS_EVT_CONNECT) return;
+  char b[160];
+  snprintf(b, sizeof(b), "{\"name\":\"NMEA Link\",\"version\":\"%s\",\"roles\":[\"master\",\"main\"],\"self\":\"vessels.self\"}", FW_VERSION);
+  c->text(b, strlen(b));
+}
+
+// ============ Salida UDP/TCP: 0183 plano o IEC 61162-450 ============
+// Plano: una sentencia por datagrama al broadcast del AP (10110); con cfgRxTag
+// cada línea (UDP y TCP) lleva antes "\\c:<UTC s>*hh\\" con su hora de recepción
+// (segundos, como en IEC 61162-450: mismo tag, misma unidad en los dos modos).
+// IEC 61162-450 (cfgIec450): "UdPbC\0" y, por línea, "\s:SFI,n:N,c:T*hh\" + sentencia + CRLF.
+// Las líneas se juntan por grupo multicast en un buffer fijo: el datagrama sale
+// al llenarse o IEC_BATCH_MS después de su primera línea. Sólo desde TaskOut.
+enum IecGroup : uint8_t { IEC_MISC=0, IEC_TGTD, IEC_SATD, IEC_NAVD, IEC_GROUPS };
+struct IecGroupDef { const char* name; uint8_t ipLast; uint16_t port; };   // 239.192.0.x
+static const IecGroupDef IEC_GROUP_DEF[IEC_GROUPS] = {
+  {"MISC", 1, 60001}, {"TGTD", 2, 60002}, {"SATD", 3, 60003}, {"NAVD", 4, 60004},
+};
+// sensors[i] → grupo: AIS/radar son blancos, el rumbo va por el de alta tasa, CUSTOM a MISC
+static const uint8_t SENSOR_IEC_GROUP[] = {IEC_NAVD, IEC_NAVD, IEC_SATD, IEC_NAVD, IEC_NAVD, IEC_TGTD, IEC_NAVD, IEC_TGTD, IEC_MISC};
+static_assert(sizeof(SENSOR_IEC_GROUP) == sizeof(sensors)/sizeof(sensors[0]), "SENSOR_IEC_GROUP desalineado");
+
+static const size_t   IEC_DGRAM_MAX = 1472;   // sin fragmentación IP
+static const size_t   IEC_TAG_MAX   = 40;     // "\s:XX0000,n:999,c:4294967295*hh\"
+static const uint32_t IEC_BATCH_MS  = 25;
+static const int      IEC_LINE_MAX  = 64;     // líneas por datagrama (las más cortas ocupan ~25 B)
+struct IecBatch {
+  char     buf[IEC_DGRAM_MAX];
+  uint16_t len;                               // 0 = vacío
+  uint32_t firstMs;
+  uint8_t  lines;
+  uint32_t rxUs[IEC_LINE_MAX];                // para la latencia al enviar
+};
+static IecBatch iecBatch[IEC_GROUPS];
+static uint16_t iecLineCount = 0;             // n: 1..999, uno para toda la fuente
+std::atomic<uint32_t> iecDatagrams(0);
+std::atomic<uint32_t> iecLines(0);
+
+// SFI: talker (2 letras) + instancia (4 dígitos), p. ej. "GP0001"
+static bool iecSrcValid(const char* s){
+  if(strlen(s)!=6) return false;
+  for(int i=0;i<6;i++){
+    if(i<2 ? !(s[i]>='A' && s[i]<='Z') : !(s[i]>='0' && s[i]<='9')) return false;
+  }
+  return true;
+}
+
+// UTC en ms en el instante 'atMs' (reloj de millis()): fecha/hora de la última
+// RMC/GGA corrida por lo transcurrido; 0 = desconocida.
+// 'vessel' lo escribe TaskProc: se lee por el seqlock.
+static uint64_t utcMsAt(uint32_t atMs){
+  const VesselState v = vesselSnapshot();
+  if(!v.tTime || !v.dateDdmmyy) return 0;
+  int32_t d = v.dateDdmmyy, yy = d%100, t = v.utcTimeCs;
+  int32_t y = yy + (yy<80 ? 2000 : 1900), m = (d/100)%100, day = d/10000;
+  if(m<1 || m>12 || day<1 || day>31) return 0;
+  y -= (m <= 2);                                              // días desde 1970-01-01 (calendario civil)
+  uint32_t yoe  = (uint32_t)(y % 400);
+  uint32_t doy  = (153*(m > 2 ? m-3 : m+9) + 2)/5 + day - 1;
+  uint32_t days = (uint32_t)(y/400)*146097 + yoe*365 + yoe/4 - yoe/100 + doy - 719468;
+  uint32_t dayMs = ((t/1000000)*3600 + ((t/10000)%100)*60 + (t/100)%100)*1000 + (t%100)*10;
+  return (uint64_t)days*86400000ull + dayMs + (int32_t)(atMs - v.tTime);
+}
+// Estampa de recepción → reloj de millis(). Sin estampa = ahora.
+static uint32_t rxToMs(uint32_t rxUs, uint32_t now){
+  return rxUs ? now - (stampUs() - rxUs)/1000 : now;
+}
+
+// Arma el tag block en el lugar, calculando el checksum mientras copia
+struct TagWriter {
+  char*   p;
+  uint8_t cs;
+  void c(char ch){ *p++ = ch; cs ^= (uint8_t)ch; }
+  void s(const char* t){ while(*t) c(*t++); }
+  void u(uint64_t v){ char d[20]; int n=0; do { d[n++] = '0' + v%10; v /= 10; } while(v); while(n) c(d[--n]); }
+  char* close(){                              // "*hh\\" → devuelve el final
+    static const char HEXD[] = "0123456789ABCDEF";
+    *p++ = '*'; *p++ = HEXD[cs >> 4]; *p++ = HEXD[cs & 15]; *p++ = '\\';
+    return p;
+  }
+};
+
+// Parámetro c: (hora de recepción, segundos UTC como pide IEC 61162-1) para
+// las dos salidas. sep = "" o ","; false si todavía no hay hora UTC.
+static bool tagRxTime(TagWriter& t, const char* sep, uint32_t rxUs, uint32_t now){
+  uint64_t utc = utcMsAt(rxToMs(rxUs, now));
+  if(!utc) return false;
+  t.s(sep); t.s("c:"); t.u(utc/1000);
+  return true;
+}
+
+// "\\c:<UTC s>*hh\\" para la salida plana; 0 si todavía no hay hora UTC
+static const size_t RX_TAG_MAX = 24;
+static size_t rxTimeTag(char* out, uint32_t rxUs){
+  out[0] = '\\';
+  TagWriter t{out+1, 0};
+  if(!tagRxTime(t, "", rxUs, millis())) return 0;
+  return t.close() - out;
+}
+
+static void iecFlush(uint8_t g){
+  IecBatch& b = iecBatch[g];
+  if(!b.len) return;
+  if(netReady){
+    const IecGroupDef& d = IEC_GROUP_DEF[g];
+    udp.beginPacket(IPAddress(239,192,0,d.ipLast), d.port);
+    udp.write((const uint8_t*)b.buf, b.len);
+    udp.endPacket();
+    iecDatagrams.fetch_add(1, std::memory_order_relaxed);
+    for(int i=0;i<b.lines;i++) latRecord(b.rxUs[i]);
+  }
+  b.len = 0;
+  b.lines = 0;
+}
+
+static void iecAppend(uint8_t g, const char* line, size_t len, uint32_t rxUs, uint32_t now){
+  const size_t need = IEC_TAG_MAX + len + 2;
+  if(6 + need > IEC_DGRAM_MAX) return;                        // no entra ni sola (MAX_LINE_LEN lo evita)
+  IecBatch& b = iecBatch[g];
+  if(b.len && (b.len + need > IEC_DGRAM_MAX || b.lines == IEC_LINE_MAX)) iecFlush(g);
+  if(!b.len){ memcpy(b.buf, "UdPbC", 6); b.len = 6; b.firstMs = now; }   // 6 = incluye el '\0'
+
+  iecLineCount = iecLineCount % 999 + 1;
+  char* p = b.buf + b.len;
+  *p++ = '\\';
+  TagWriter t{p, 0};
+  t.s("s:"); t.s(iecSrc);
+  t.s(",n:"); t.u(iecLineCount);
+  tagRxTime(t, ",", rxUs, now);
+  p = t.close();
+  memcpy(p, line, len); p += len;
+  *p++ = '\r'; *p++ = '\n';
+  b.len = (uint16_t)(p - b.buf);
+  b.rxUs[b.lines++] = rxUs;
+  iecLines.fetch_add(1, std::memory_order_relaxed);
+}
+
+// En cada vuelta de TaskOut
+void iecFlushIfDue(uint32_t now){
+  for(uint8_t g=0; g<IEC_GROUPS; g++){
+    if(iecBatch[g].len && now - iecBatch[g].firstMs >= IEC_BATCH_MS) iecFlush(g);
+  }
+}
+
+// cat = índice en sensors[] (-1 = desconocida); rxUs = stampUs() de llegada (0 = generada acá)
+void sendUDP(const char* line, size_t len, int cat, uint32_t rxUs){
+  if(!netReady) return;   // el pipeline puede arrancar antes que el AP
+  if(cfgIec450){
+    iecAppend(cat>=0 ? SENSOR_IEC_GROUP[cat] : IEC_MISC, line, len, rxUs, millis());
+    return;
+  }
+  char tag[RX_TAG_MAX];
+  size_t tagLen = cfgRxTag ? rxTimeTag(tag, rxUs) : 0;
+  udp.beginPacket(udpAddress, udpPort);
+  if(tagLen) udp.write((const uint8_t*)tag, tagLen);
+  udp.write((const uint8_t*)line, len);
+  udp.endPacket();
+  latRecord(rxUs);
+}
+
+// Un cliente lento no frena a nadie: si no hay lugar en su ventana, la línea se descarta
+void sendTCP(const char* line, size_t len, uint32_t rxUs){
+  if(!tcpClientCount) return;
+  char tag[RX_TAG_MAX];
+  size_t tagLen = cfgRxTag ? rxTimeTag(tag, rxUs) : 0;
+  xSemaphoreTake(tcpMutex,portMAX_DELAY);
+  for(int i=0;i<TCP_MAX_CLIENTS;i++){
+    AsyncClient* c = tcpClients[i];
+    if(!c) continue;
+    if(c->space() < tagLen+len+2){ tcpDrops.fetch_add(1, std::memory_order_relaxed); continue; }
+    if(tagLen) c->add(tag, tagLen);
+    c->add(line, len);
+    c->add("\r\n", 2);
+    c->send();
+  }
+  xSemaphoreGive(tcpMutex);
+}
+
+// ============ Historial (PSRAM) ============
+// Anillo de registros empaquetados [HistRec + texto] en PSRAM; sin PSRAM, uno
+// chico en RAM interna. Un registro nunca cruza el final del anillo: si no
+// entra, queda un HIST_F_PAD (o menos de un header libre) y sigue al principio.
+// Las posiciones son absolutas módulo histMod (múltiplo del tamaño): las
+// distancias siguen valiendo al dar la vuelta. Índice por tiempo: un bucket por
+// segundo con la posición de su primer registro. /search arranca ahí y recorre
+// hacia adelante filtrando por ID, con tope de pasos por trozo y por pedido.
+// Sólo TaskProc escribe. Es un seqlock sobre histTail: el escritor guarda la
+// cola nueva y pone un fence release antes de pisar los bytes; los lectores
+// (/search) copian, fence acquire, y confirman que la posición sigue dentro de
+// [histTail, histHead). Si el escritor la pisó, ven la cola nueva y descartan.
+struct __attribute__((packed)) HistRec {
+  uint32_t ms;
+  uint8_t  len;          // texto, sin terminador
+  uint8_t  flags;        // HIST_F_*
+};
+enum : uint8_t { HIST_F_TX = 0x01, HIST_F_BAD = 0x02, HIST_F_PAD = 0x80 };
+static const size_t   HIST_PSRAM_MAX   = 12u<<20;    // tope del anillo
+static const size_t   HIST_PSRAM_KEEP  = 512u<<10;   // PSRAM que queda para el resto
+static const size_t   HIST_RAM_BYTES   = 32u<<10;    // placas sin PSRAM
+static const uint32_t HIST_BUCKETS_PSRAM = 65536;    // 18 h a un bucket por segundo
+static const uint32_t HIST_BUCKETS_RAM   = 256;
+static const uint32_t HIST_BUCKET_MS   = 1000;
+static const uint32_t HIST_SCAN_STEP   = 2048;       // registros leídos por trozo de /search
+static const uint32_t HIST_SCAN_MAX    = 262144;     // y por pedido: después, "# more from=<ms>"
+struct HistBucket { uint32_t ms; uint32_t pos; };
+
+uint8_t*    histBuf       = nullptr;
+uint32_t    histSize      = 0;            // 0 = sin historial (no hubo memoria)
+uint32_t    histMod       = 0;
+bool        histPsram     = false;
+HistBucket* histBuckets   = nullptr;
+uint32_t    histBucketCap = 0;
+std::atomic<uint32_t> histHead(0);        // próxima posición a escribir
+std::atomic<uint32_t> histTail(0);        // registro más viejo todavía válido
+std::atomic<uint32_t> histBucketN(0);     // buckets escritos desde el arranque
+std::atomic<uint32_t> histCount(0);       // registros vivos
+
+static inline uint32_t histAdv(uint32_t p, uint32_t n){
+  uint64_t q = (uint64_t)p + n;
+  return (uint32_t)(q >= histMod ? q - histMod : q);
+}
+static inline uint32_t histDist(uint32_t from, uint32_t to){ return to >= from ? to - from : to + (histMod - from); }
+static inline uint32_t histOff(uint32_t p){ return p % histSize; }
+static inline uint32_t histLapStart(uint32_t p){ return histAdv(p, histSize - histOff(p)); }
+static inline bool     histLive(uint32_t p, uint32_t tail, uint32_t head){ return histDist(tail, p) < histDist(tail, head); }
+
+void histBegin(){
+  size_t bytes = 0;
+  if(psramFound()){
+    size_t freeP = ESP.getFreePsram();
+    size_t idx   = HIST_BUCKETS_PSRAM * sizeof(HistBucket);
+    if(freeP > HIST_PSRAM_KEEP + idx + (1u<<20)) bytes = min(freeP - HIST_PSRAM_KEEP - idx, HIST_PSRAM_MAX);
+  }
+  if(bytes){
+    histBuckets = (HistBucket*)ps_malloc(HIST_BUCKETS_PSRAM * sizeof(HistBucket));
+    histBuf     = (uint8_t*)ps_malloc(bytes);
+    histPsram   = histBuckets && histBuf;
+    if(histPsram) histBucketCap = HIST_BUCKETS_PSRAM;
+    else { free(histBuckets); free(histBuf); }
+  }
+  if(!histPsram){
+    bytes         = HIST_RAM_BYTES;
+    histBuckets   = (HistBucket*)malloc(HIST_BUCKETS_RAM * sizeof(HistBucket));
+    histBuf       = (uint8_t*)malloc(bytes);
+    histBucketCap = HIST_BUCKETS_RAM;
+    if(!histBuckets || !histBuf){ free(histBuckets); free(histBuf); histBuf = nullptr; histBuckets = nullptr; return; }
+  }
+  histSize = bytes;
+  histMod  = (0xFFFFFFFFu / histSize) * histSize;
+}
+
+// Lee el header en p; true si sigue vivo después de copiarlo (text opcional, ≥255 B)
+static bool histRead(uint32_t p, HistRec& h, char* text){
+  uint32_t tail = histTail.load(std::memory_order_acquire);
+  uint32_t head = histHead.load(std::memory_order_acquire);
+  if(!histLive(p, tail, head)) return false;
+  uint32_t off = histOff(p);
+  if(histSize - off < sizeof(HistRec)){ memset(&h, 0, sizeof(h)); h.flags = HIST_F_PAD; return true; }
+  memcpy(&h, histBuf + off, sizeof(h));
+  if(!(h.flags & HIST_F_PAD)){
+    if(off + sizeof(HistRec) + h.len > histSize) return false;   // header a medio pisar
+    if(text) memcpy(text, histBuf + off + sizeof(HistRec), h.len);
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return histLive(p, histTail.load(std::memory_order_relaxed), histHead.load(std::memory_order_relaxed));
+}
+static inline uint32_t histNext(uint32_t p, const HistRec& h){
+  return (h.flags & HIST_F_PAD) ? histLapStart(p) : histAdv(p, sizeof(HistRec) + h.len);
+}
+
+// TaskProc: todo lo recibido (también inválidas y repetidas) y lo generado
+void histAppend(const String& s, uint32_t ms, uint8_t flags){
+  if(!histSize) return;
+  const uint32_t len  = min<uint32_t>(s.length(), 255);
+  const uint32_t need = sizeof(HistRec) + len;
+  uint32_t head  = histHead.load(std::memory_order_relaxed);
+  uint32_t start = (histSize - histOff(head) < need) ? histLapStart(head) : head;
+  uint32_t end   = histAdv(start, need);
+
+  // Liberar lo que se va a pisar (la cola se publica antes de escribir)
+  uint32_t tail = histTail.load(std::memory_order_relaxed);
+  while(tail != head && histDist(tail, end) > histSize){
+    uint32_t off = histOff(tail);
+    HistRec h;
+    if(histSize - off < sizeof(HistRec)){ tail = histLapStart(tail); continue; }
+    memcpy(&h, histBuf + off, sizeof(h));
+    if(!(h.flags & HIST_F_PAD)) histCount.fetch_sub(1, std::memory_order_relaxed);
+    tail = histNext(tail, h);
+  }
+  if(tail == head) tail = start;                        // vacío (o todo pisado)
+  histTail.store(tail, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);  // la cola nueva antes que cualquier byte pisado
+
+  if(start != head && histSize - histOff(head) >= sizeof(HistRec)){
+    HistRec pad = {ms, 0, HIST_F_PAD};
+    memcpy(histBuf + histOff(head), &pad, sizeof(pad));
+  }
+  HistRec r = {ms, (uint8_t)len, flags};
+  uint8_t* dst = histBuf + histOff(start);
+  memcpy(dst, &r, sizeof(r));
+  memcpy(dst + sizeof(r), s.c_str(), len);
+  histHead.store(end, std::memory_order_release);
+  histCount.fetch_add(1, std::memory_order_relaxed);
+
+  uint32_t n = histBucketN.load(std::memory_order_relaxed);
+  if(!n || histBuckets[(n-1) % histBucketCap].ms / HIST_BUCKET_MS != ms / HIST_BUCKET_MS){
+    histBuckets[n % histBucketCap] = {ms, start};
+    histBucketN.store(n+1, std::memory_order_release);
+  }
+}
+
+// Primera posición desde la que vale la pena recorrer para 'from' (búsqueda binaria en los buckets)
+static uint32_t histSeek(uint32_t from){
+  uint32_t tail = histTail.load(std::memory_order_acquire), head = histHead.load(std::memory_order_acquire);
+  uint32_t n  = histBucketN.load(std::memory_order_acquire);
+  uint32_t lo = n > histBucketCap ? n - histBucketCap + 1 : 0;   // el más viejo puede estar reescribiéndose
+  uint32_t hi = n;                                                // último bucket con ms <= from: [lo, hi)
+  if(lo >= hi || histBuckets[lo % histBucketCap].ms > from) return tail;
+  while(hi - lo > 1){
+    uint32_t mid = lo + (hi - lo)/2;
+    if(histBuckets[mid % histBucketCap].ms <= from) lo = mid; else hi = mid;
+  }
+  uint32_t p = histBuckets[lo % histBucketCap].pos;
+  return histLive(p, tail, head) ? p : tail;
+}
+
+// Estado de una búsqueda en curso (vive mientras dura la respuesta chunked)
+struct HistSearch {
+  char     id[6];        // "" = cualquiera; 3 letras = cualquier talker
+  uint8_t  idLen;
+  uint32_t from, to;
+  uint32_t limit, sent;
+  uint32_t cur;          // cursor de recorrido (desde histSeek(from))
+  uint32_t scanned;      // registros leídos en todo el pedido (≤ HIST_SCAN_MAX)
+  uint32_t lastMs;       // ms del último leído: para seguir con from=
+  bool     done;
+  char     line[300];
+  uint16_t lineLen, lineOff;
+};
+
+static bool histIdMatches(const HistSearch& q, const char* text, uint8_t len){
+  if(!q.idLen) return true;
+  if(len < 6) return false;
+  return (q.idLen==3) ? !memcmp(q.id, text+3, 3) : !memcmp(q.id, text+1, 5);
+}
+
+enum HistStep : uint8_t { HIST_LINE, HIST_END, HIST_BUDGET };
+// Próxima línea "<ms> RX|TX|BAD <sentencia>\n" en q.line, leyendo a lo sumo
+// 'budget' registros (se descuentan). Al llegar a HIST_SCAN_MAX deja
+// "# more from=<ms>" para que el cliente siga desde ahí.
+static HistStep histNextLine(HistSearch& q, uint32_t& budget){
+  if(q.done || q.sent >= q.limit) return HIST_END;
+  char text[256];
+  HistRec h;
+  for(;;){
+    if(!budget) return HIST_BUDGET;
+    if(q.scanned >= HIST_SCAN_MAX){
+      q.lineLen = snprintf(q.line, sizeof(q.line), "# more from=%lu\n", (unsigned long)q.lastMs);
+      q.lineOff = 0;
+      q.done = true;
+      return HIST_LINE;
+    }
+    uint32_t p = q.cur;
+    if(p == histHead.load(std::memory_order_acquire)){ q.done = true; return HIST_END; }
+    budget--; q.scanned++;
+    if(!histRead(p, h, text)){ q.cur = histSeek(q.from); if(q.cur == p){ q.done = true; return HIST_END; } continue; }   // pisado mientras tanto
+    q.cur = histNext(p, h);
+    if(h.flags & HIST_F_PAD) continue;
+    q.lastMs = h.ms;
+    if(h.ms < q.from) continue;
+    if(h.ms > q.to){ q.done = true; return HIST_END; }
+    if(!histIdMatches(q, text, h.len)) continue;
+    const char* kind = (h.flags & HIST_F_TX) ? "TX" : ((h.flags & HIST_F_BAD) ? "BAD" : "RX");
+    int n = snprintf(q.line, sizeof(q.line), "%lu %s ", (unsigned long)h.ms, kind);
+    memcpy(q.line + n, text, h.len);
+    q.line[n + h.len] = '\n';
+    q.lineLen = n + h.len + 1;
+    q.lineOff = 0;
+    q.sent++;
+    return HIST_LINE;
+  }
+}
+
 // ============ Serial control ============
 void startSerial(int baud){
   xSemaphoreTake(serialMutex,portMAX_DELAY);
   NMEA_Serial.end(); delay(5);
+  NMEA_Serial.setRxBufferSize(UART_RX_BUF);
   NMEA_Serial.begin(baud, SERIAL_8N1, RX_PIN, TX_PIN);
+  NMEA_Serial.onReceiveError([](hardwareSerial_error_t e){
+    if(e==UART_FIFO_OVF_ERROR || e==UART_BUFFER_FULL_ERROR) statUartOvf.fetch_add(1, std::memory_order_relaxed);
+  });
   while(NMEA_Serial.available()) (void)NMEA_Serial.read();
   currentBaud = baud;
   xSemaphoreGive(serialMutex);
 }
 
+// ============ Persistencia (NVS) ============
+// Blob binario compacto y versionado: 'nmealink/cfg'. Escritura con debounce
+// (las ediciones rápidas del generador no gastan la flash) y sólo si cambió.
+static const uint32_t CFG_MAGIC           = 0x314B4C4E;  // "NLK1"
+static const uint16_t CFG_VERSION         = 4;
+static const uint32_t CFG_SAVE_DEBOUNCE_MS = 3000;
+struct __attribute__((packed)) CfgBlob {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;
+  uint32_t baud;
+  uint8_t  mode;          // AppMode
+  uint8_t  flags;         // CFG_F_*
+  uint16_t monFilterMask; // bit i = categoría i del monitor
+  GenSlotCfg slots[MAX_SLOTS];
+  // v2
+  uint16_t udpFilterMask;
+  uint16_t tcpFilterMask;
+  IdRule   idRules[ID_RULE_MAX];
+  // v3
+  uint16_t dedupWindowMs;
+  uint16_t dedupKeepAliveMs;
+  // v4
+  uint8_t  flags2;        // CFG_F2_*
+  char     iecSrc[7];
+  uint32_t hash;          // FNV-1a de todo lo anterior
+};
+// Largo del cuerpo (sin hash) de cada versión: las nuevas sólo agregan al final
+static size_t cfgBodyLen(uint16_t version){
+  switch(version){
+    case 1:  return offsetof(CfgBlob, udpFilterMask);
+    case 2:  return offsetof(CfgBlob, dedupWindowMs);
+    case 3:  return offsetof(CfgBlob, flags2);
+    case 4:  return offsetof(CfgBlob, hash);
+    default: return 0;
+  }
+}
+enum : uint8_t {
+  CFG_F_AUTORESUME = 0x01,  // reanudar al arrancar lo que estaba corriendo
+  CFG_F_SKIPSPLASH = 0x02,
+  CFG_F_MON_RUN    = 0x04,  // estado al guardar
+  CFG_F_GEN_RUN    = 0x08,
+  CFG_F_DEDUP      = 0x10,
+  CFG_F_SK_WS      = 0x20,
+  CFG_F_SK_UDP     = 0x40,
+  CFG_F_N2K        = 0x80,
+};
+enum : uint8_t {
+  CFG_F2_IEC450    = 0x01,
+  CFG_F2_RXTAG     = 0x02,
+};
+
+Preferences prefs;
+CfgBlob  cfgSaved;                 // último blob escrito/leído (evita escrituras iguales)
+volatile bool     cfgDirty   = false;
+volatile uint32_t cfgDirtyMs = 0;
+volatile uint32_t cfgWrites  = 0;
+
+static uint32_t fnv1a(const uint8_t* p, size_t n){
+  uint32_t h=2166136261u;
+  for(size_t i=0;i<n;i++){ h^=p[i]; h*=16777619u; }
+  return h;
+}
+void markConfigDirty(){ cfgDirtyMs = millis(); cfgDirty = true; }
+// ============ Slots: publicación hacia el generador ============
+// Lector del TX loop: sin locks; reintenta sólo si justo se publicó otra versión.
+const GenConfig* genAcquire(){ return genPub.acquire(); }
+void genRelease(){ genPub.release(); }
+
+// Escritores (handlers/boot): copiar vigente → modificar → publicar. Nunca esperan al generador.
+template<class F> void genUpdate(F fn){
+  xSemaphoreTake(slotWriteMutex,portMAX_DELAY);
+  genPub.publish(fn);
+  xSemaphoreGive(slotWriteMutex);
+}
+// Copia para lectores web/persistencia (no es camino caliente)
+GenConfig genSnapshot(){
+  xSemaphoreTake(slotWriteMutex,portMAX_DELAY);
+  GenConfig c = genPub.current();
+  xSemaphoreGive(slotWriteMutex);
+  return c;
+}
+void setStr(char* dst, size_t cap, const char* src){
+  strncpy(dst, src, cap-1); dst[cap-1]=0;
+}
+#define SET_STR(dst, src) setStr(dst, sizeof(dst), src)
+
+static void buildConfig(CfgBlob& c){
+  memset(&c, 0, sizeof(c));
+  c.magic = CFG_MAGIC; c.version = CFG_VERSION; c.size = sizeof(CfgBlob);
+  int reqBaud = baudRequest.load(std::memory_order_relaxed);
+  c.baud  = reqBaud ? reqBaud : currentBaud;
+  c.mode  = (uint8_t)appMode;
+  c.flags = (cfgAutoResume?CFG_F_AUTORESUME:0) | (cfgSkipSplash?CFG_F_SKIPSPLASH:0)
+          | (monitorRunning?CFG_F_MON_RUN:0)   | (generatorRunning?CFG_F_GEN_RUN:0)
+          | (cfgDedup?CFG_F_DEDUP:0)           | (cfgSkWs?CFG_F_SK_WS:0) | (cfgSkUdp?CFG_F_SK_UDP:0)
+          | (cfgN2k?CFG_F_N2K:0);
+  c.monFilterMask = outCatMask[OUT_WEB];
+  c.udpFilterMask = outCatMask[OUT_UDP];
+  c.tcpFilterMask = outCatMask[OUT_TCP];
+  c.dedupWindowMs    = dedupWindowMs;
+  c.dedupKeepAliveMs = dedupKeepAliveMs;
+  c.flags2 = (cfgIec450?CFG_F2_IEC450:0) | (cfgRxTag?CFG_F2_RXTAG:0);
+  SET_STR(c.iecSrc, iecSrc);
+  GenConfig g = genSnapshot();
+  memcpy(c.slots, g.slot, sizeof(c.slots));
+  xSemaphoreTake(slotWriteMutex,portMAX_DELAY);
+  memcpy(c.idRules, idRules, sizeof(c.idRules));
+  xSemaphoreGive(slotWriteMutex);
+  c.hash = fnv1a((const uint8_t*)&c, offsetof(CfgBlob, hash));
+}
+
+// Devuelve true si había una config válida (se aplicó)
+bool loadConfig(){
+  prefs.begin("nmealink", false);
+  CfgBlob c;
+  size_t len = prefs.getBytesLength("cfg");
+  if(len < sizeof(uint32_t)*2 || len > sizeof(c)) return false;
+  memset(&c, 0, sizeof(c));
+  prefs.getBytes("cfg", &c, len);
+  size_t body = cfgBodyLen(c.version);
+  if(c.magic!=CFG_MAGIC || !body || c.size!=len || len!=body+sizeof(uint32_t)) return false;
+  uint32_t h; memcpy(&h, (const uint8_t*)&c + body, sizeof(h));
+  if(h != fnv1a((const uint8_t*)&c, body)) return false;
+  if(c.version < CFG_VERSION) memset((uint8_t*)&c + body, 0, sizeof(c) - body);   // campos que esa versión no tenía
+  if(c.version < 2){ c.udpFilterMask = c.tcpFilterMask = FILTER_ALL; }
+  if(c.version < 3){ c.dedupWindowMs = dedupWindowMs; c.dedupKeepAliveMs = dedupKeepAliveMs; }
+  if(c.version < 4){ SET_STR(c.iecSrc, iecSrc); }
+
+  if(c.baud==4800||c.baud==9600||c.baud==38400||c.baud==115200) currentBaud = c.baud;
+  appMode        = (c.mode==MODE_GENERATOR) ? MODE_GENERATOR : MODE_MONITOR;
+  cfgAutoResume  = c.flags & CFG_F_AUTORESUME;
+  cfgSkipSplash  = c.flags & CFG_F_SKIPSPLASH;
+  cfgDedup       = c.flags & CFG_F_DEDUP;
+  cfgSkWs        = c.flags & CFG_F_SK_WS;
+  cfgSkUdp       = c.flags & CFG_F_SK_UDP;
+  cfgN2k         = c.flags & CFG_F_N2K;
+  cfgIec450      = c.flags2 & CFG_F2_IEC450;
+  cfgRxTag       = c.flags2 & CFG_F2_RXTAG;
+  c.iecSrc[sizeof(c.iecSrc)-1]=0;
+  if(iecSrcValid(c.iecSrc)) SET_STR(iecSrc, c.iecSrc);
+  if(c.dedupWindowMs    >= 100) dedupWindowMs    = c.dedupWindowMs;
+  if(c.dedupKeepAliveMs >= 500) dedupKeepAliveMs = c.dedupKeepAliveMs;
+  outCatMask[OUT_WEB] = c.monFilterMask & FILTER_ALL;
+  outCatMask[OUT_UDP] = c.udpFilterMask & FILTER_ALL;
+  outCatMask[OUT_TCP] = c.tcpFilterMask & FILTER_ALL;
+  memcpy(idRules, c.idRules, sizeof(idRules));
+  for(auto& r : idRules) r.id[sizeof(r.id)-1]=0;
+  genUpdate([&](GenConfig& g){
+    for(int i=0;i<MAX_SLOTS;i++){
+      GenSlotCfg& d = g.slot[i];
+      d = c.slots[i];
+      d.sensor[sizeof(d.sensor)-1]=0;
+      d.sentence[sizeof(d.sentence)-1]=0;
+      d.text[sizeof(d.text)-1]=0;
+      if(d.intervalMs<50) d.intervalMs=50;
+    }
+  });
+  if(cfgAutoResume){
+    monitorRunning   = (appMode==MODE_MONITOR)   && (c.flags & CFG_F_MON_RUN);
+    generatorRunning = (appMode==MODE_GENERATOR) && (c.flags & CFG_F_GEN_RUN);
+  }
+  cfgSaved = c;
+  return true;
+}
+
+// Llamado periódicamente (TaskUI). Escribe sólo tras CFG_SAVE_DEBOUNCE_MS sin cambios.
+void saveConfigIfDue(){
+  if(!cfgDirty || (millis()-cfgDirtyMs) < CFG_SAVE_DEBOUNCE_MS) return;
+  cfgDirty = false;
+  CfgBlob c; buildConfig(c);
+  if(memcmp(&c, &cfgSaved, sizeof(c))==0) return;
+  if(prefs.putBytes("cfg", &c, sizeof(c))==sizeof(c)){ cfgSaved = c; cfgWrites++; }
+}
+
 // ============ Web helpers ============
-void noCache(){
-  server.sendHeader("Cache-Control","no-store, no-cache, must-revalidate, max-age=0");
-  server.sendHeader("Pragma","no-cache");
-  server.sendHeader("Expires","0");
-}
-void handle204(){ noCache(); server.send(204,"text/plain",""); }
-void handleCaptive(){
-  noCache();
-  server.send(200,"text/html; charset=utf-8",
+void noCache(AsyncWebServerResponse* res){
+  res->addHeader("Cache-Control","no-store, no-cache, must-revalidate, max-age=0");
+  res->addHeader("Pragma","no-cache");
+  res->addHeader("Expires","0");
+}
+void sendNoCache(AsyncWebServerRequest* req, int code, const char* type, const String& body){
+  AsyncWebServerResponse* res=req->beginResponse(code,type,body);
+  noCache(res);
+  req->send(res);
+}
+void sendNoCache(AsyncWebServerRequest* req, int code, const char* type, const char* body){
+  AsyncWebServerResponse* res=req->beginResponse(code,type,body);   // copia el contenido
+  noCache(res);
+  req->send(res);
+}
+void handle204(AsyncWebServerRequest* req){ sendNoCache(req,204,"text/plain",""); }
+void handleCaptive(AsyncWebServerRequest* req){
+  sendNoCache(req,200,"text/html; charset=utf-8",
     F("<!doctype html><html><meta name='viewport' content='width=device-width, initial-scale=1.0'>"
       "<title>NMEA Link</title><body style='background:#000;color:#0f0;font-family:system-ui,-apple-system,Segoe UI,Roboto,Helvetica,Arial,Noto Sans,Liberation Sans,sans-serif;'>"
       "<p>Redirecting…</p><script>location.href='/'</script></body></html>")
   );
 }
 
+// ============ Carga web: pistas de sondeo y prioridad ============
+// Los pedidos de datos (consolas, /search) se miden: tiempo ocupado del
+// handler y cantidad, por ventana de 1 s. Cada respuesta de consola lleva:
+//   X-Lines    líneas nuevas en esta respuesta
+//   X-Busy     % de la ventana anterior ocupado en pedidos de datos
+//   X-Poll-Ms  cuándo conviene volver a pedir
+// Saturado (ocupado > WEB_SHED_BUSY_PCT o demasiados pedidos en la ventana),
+// un pedido de datos se contesta 503 + X-Poll-Ms sin armar nada. Los de
+// control (/setmonitor, /setbaud, /togglegen...) no pasan por acá: nunca
+// esperan detrás de una consola.
+static const uint32_t WEB_WINDOW_MS      = 1000;
+static const uint8_t  WEB_SHED_BUSY_PCT  = 40;
+static const uint16_t WEB_DATA_MAX       = 25;      // pedidos de datos por ventana
+static const uint32_t POLL_MIN_MS        = 150;
+static const uint32_t POLL_MAX_MS        = 2000;    // consola quieta
+static const uint32_t POLL_SHED_MS       = 3000;
+static const uint32_t POLL_TARGET_LINES  = 20;      // líneas por respuesta a las que se apunta
+// Todo en la tarea de AsyncTCP: un solo hilo, sin atomics
+struct WebLoad {
+  uint32_t winStart = 0;
+  uint32_t busyUs   = 0;       // ventana en curso
+  uint16_t reqs     = 0;
+  uint8_t  busyPct  = 0;       // ventana anterior
+  uint16_t lastReqs = 0;
+  uint32_t shed     = 0;       // 503 desde el arranque
+} webLoad;
+
+static void webLoadRoll(uint32_t now){
+  uint32_t dt = now - webLoad.winStart;
+  if(dt < WEB_WINDOW_MS) return;
+  webLoad.busyPct  = (uint8_t)min<uint32_t>(webLoad.busyUs / (dt * 10), 100);   // µs / (ms·10) = %
+  webLoad.lastReqs = webLoad.reqs;
+  webLoad.busyUs = 0; webLoad.reqs = 0;
+  webLoad.winStart = now;
+}
+// Admisión de un pedido de datos: 0 = rechazado (ya contestado con 503)
+static uint32_t webDataBegin(AsyncWebServerRequest* req){
+  webLoadRoll(millis());
+  if(webLoad.busyPct > WEB_SHED_BUSY_PCT || webLoad.reqs >= WEB_DATA_MAX){
+    webLoad.shed++;
+    AsyncWebServerResponse* res = req->beginResponse(503, "text/plain", "busy");
+    noCache(res);
+    res->addHeader("X-Poll-Ms", String(POLL_SHED_MS));
+    res->addHeader("Retry-After", "3");
+    req->send(res);
+    return 0;
+  }
+  webLoad.reqs++;
+  return stampUs();
+}
+static void webDataEnd(uint32_t t0){ webLoad.busyUs += stampUs() - t0; }
+
+// Próximo sondeo para una consola de 'ring' líneas que recibe 'rate' líneas/s:
+// ~POLL_TARGET_LINES por respuesta, antes de que el anillo se llene a la mitad,
+// y más espaciado cuanto más ocupado esté el servidor.
+static uint32_t pollHintMs(uint16_t rate, uint32_t ring){
+  uint32_t ms = POLL_MAX_MS;
+  if(rate){
+    ms = min<uint32_t>(POLL_TARGET_LINES*1000u / rate, (ring/2)*1000u / rate);
+    ms = constrain(ms, POLL_MIN_MS, POLL_MAX_MS);
+  }
+  if(webLoad.busyPct > 10) ms = ms * (10 + webLoad.busyPct/5) / 10;          // 40 % → ×1.8
+  if(webLoad.lastReqs > WEB_DATA_MAX/2) ms *= 2;                              // muchos clientes
+  return min<uint32_t>(ms, POLL_SHED_MS);
+}
+
+// Respuesta de consola con las pistas de carga
+static void sendConsole(AsyncWebServerRequest* req, const String& body, uint32_t lines, uint32_t pollMs){
+  AsyncWebServerResponse* res = req->beginResponse(200, "text/plain", body);
+  noCache(res);
+  res->addHeader("X-Lines",   String(lines));
+  res->addHeader("X-Busy",    String(webLoad.busyPct));
+  res->addHeader("X-Poll-Ms", String(pollMs));
+  req->send(res);
+}
+
+// ============ Static assets (gzip en flash, ver web/ + tools/embed_web.py) ============
+const WebAsset* findAsset(const char* path){
+  for(size_t i=0;i<WEB_ASSET_COUNT;i++) if(strcmp(WEB_ASSETS[i].path,path)==0) return &WEB_ASSETS[i];
+  return nullptr;
+}
+// HTML: revalidación por ETag (304 sin cuerpo). CSS/JS: URL versionada → cache de 1 año.
+void sendAsset(AsyncWebServerRequest* req, const WebAsset& a){
+  const AsyncWebHeader* inm = req->getHeader("If-None-Match");
+  AsyncWebServerResponse* res;
+  if(inm && inm->value().indexOf(a.etag)>=0){
+    res = req->beginResponse(304);
+  } else {
+    res = req->beginResponse(200, a.mime, a.gz, a.len);
+    res->addHeader("Content-Encoding","gzip");
+  }
+  res->addHeader("ETag", a.etag);
+  res->addHeader("Cache-Control", a.immutable ? "public, max-age=31536000, immutable" : "no-cache");
+  req->send(res);
+}
+void sendPage(AsyncWebServerRequest* req, const char* path){
+  const WebAsset* a = findAsset(path);
+  if(!a){ sendNoCache(req,404,"text/plain","Not found"); return; }
+  sendAsset(req, *a);
+}
+
 // ============ MENU ============
-void handleMenu(){
+void handleMenu(AsyncWebServerRequest* req){
   // Parar TODO al entrar al menú
   generatorRunning = false;
   monitorRunning  = false;
-  otaActive       = false;
-
-  String html = F("<!doctype html><html><head><meta charset='utf-8'><title>NMEA Link</title>"
-  "<meta name='viewport' content='width=device-width, initial-scale=1.0'>"
-  "<style>body{font-family:system-ui,-apple-system,Segoe UI,Roboto,Helvetica,Arial,Noto Sans,Liberation Sans,sans-serif;background:#000;color:#0f0;margin:0;padding:10px}"
-  "h2{text-align:center;color:#0ff;margin:8px 0}.btn{padding:14px;background:#111;color:#0f0;border:1px solid #0f0;border-radius:10px;font-size:18px;cursor:pointer;text-align:center;display:block;width:100%}"
-  ".btn:hover{background:#0f0;color:#000}.stack{display:flex;flex-direction:column;gap:10px;max-width:680px;margin:12px auto}"
-  "footer{text-align:center;color:#666;font-size:12px;margin-top:10px}"
-  ".lang{position:absolute;top:10px;right:10px;background:#111;color:#0f0;border:1px solid #0f0;border-radius:6px;padding:4px}</style></head><body>");
-
-  html += F("<select id='lang' class='lang' onchange='setLang(this.value)'><option value='en'>EN</option><option value='es'>ES</option><option value='fr'>FR</option></select>"
-            "<h2 id='ttl'>NMEA Link</h2><div class='stack'>"
-            "<button type='button' class='btn' id='b1' onclick='goMon()'>NMEA Monitor</button>"
-            "<button type='button' class='btn' id='b2' onclick='goGen()'>NMEA Generator</button>"
-            "<button type='button' class='btn' id='b3' onclick='goOTA()'>OTA Update</button>"
-            "</div><footer>© 2025 Matías Scuppa — by Themys</footer>");
-
-  html +=
-    "<script>"
-    "let lang=localStorage.getItem('lang')||'en';"
-    "const L={en:{t:'NMEA Link',m:'NMEA Monitor',g:'NMEA Generator',o:'OTA Update'},"
-    "es:{t:'NMEA Link',m:'NMEA Monitor',g:'NMEA Generator',o:'Actualizar Firmware'},"
-    "fr:{t:'NMEA Link',m:'NMEA Monitor',g:'NMEA Generator',o:'Mise à jour OTA'}};"
-    "function setLang(l){lang=l;localStorage.setItem('lang',l);apply();}"
-    "function apply(){document.getElementById('ttl').innerText=L[lang].t||'NMEA Link';document.getElementById('b1').innerText=L[lang].m;document.getElementById('b2').innerText=L[lang].g;document.getElementById('b3').innerText=L[lang].o;document.getElementById('lang').value=lang;}"
-    "async function goMon(){try{await fetch('/togglegen?state=0');await fetch('/setmonitor?state=0');await fetch('/setmode?m=monitor');}catch(e){} location.href='/monitor';}"
-    "async function goGen(){try{await fetch('/togglegen?state=0');await fetch('/setmonitor?state=0');await fetch('/setmode?m=generator');}catch(e){} location.href='/generator';}"
-    "async function goOTA(){try{await fetch('/togglegen?state=0');await fetch('/setmonitor?state=0');}catch(e){} location.href='/update';}"
-    "document.addEventListener('DOMContentLoaded',apply);"
-    "</script></body></html>";
-
-  noCache(); server.send(200,"text/html; charset=utf-8",html);
+  sendPage(req,"/index.html");
 }
 
 // ============ MONITOR ============
-void handleMonitor(){
-  otaActive = false;
-  String html = F("<!doctype html><html><head><meta charset='utf-8'><title>NMEA Reader</title>"
-  "<meta name='viewport' content='width=device-width, initial-scale=1.0'>"
-  "<style>body{font-family:system-ui,-apple-system,Segoe UI,Roboto,Helvetica,Arial,Noto Sans,Liberation Sans,sans-serif;background:#000;color:#0f0;margin:0;padding:10px}"
-  "h2{text-align:center;color:#0ff;margin:8px 0}.lang{position:absolute;top:10px;right:10px;background:#111;color:#0f0;border:1px solid #0f0;border-radius:6px;padding:4px}"
-  "#console{width:100%;max-width:100%;box-sizing:border-box;height:40vh;overflow:auto;border:1px solid #0f0;padding:5px;background:#000;font-size:14px;white-space:pre-wrap;word-wrap:break-word;overflow-wrap:anywhere;margin-top:12px;font-family:ui-monospace,SFMono-Regular,Menlo,Consolas,'Liberation Mono',monospace}"
-  ".btnc{display:flex;flex-wrap:wrap;gap:5px;margin:8px 0}.btn{flex:1;padding:10px;background:#111;color:#0f0;border:1px solid #0f0;border-radius:8px;font-size:16px;text-align:center;cursor:pointer}"
-  ".btn.active{background:#0f0;color:#000;font-weight:bold}.fbtn{flex:1 1 calc(33.33% - 6px);padding:5px 0;border-radius:5px;margin:2px;text-align:center;transition:.2s;border:1px solid #333}"
-  ".fbtn:not(.active){background:#111;color:#666;border-color:#444}.fbtn.active{font-weight:600;border:1px solid #222}"
-  ".fbtn.active.GPS{background:#0ff;color:#000}.GPS{color:#0ff}"
-  ".fbtn.active.AIS{background:#ff0;color:#000}.AIS{color:#ff0}"
-  ".fbtn.active.SOUNDER{background:#0f0;color:#000}.SOUNDER{color:#0f0}"
-  ".fbtn.active.VELOCITY{background:#f0f;color:#000}.VELOCITY{color:#f0f}"
-  ".fbtn.active.HEADING{background:#1e90ff;color:#000}.HEADING{color:#1e90ff}"
-  ".fbtn.active.RADAR{background:#ff4500;color:#000}.RADAR{color:#ff4500}"
-  ".fbtn.active.WEATHER{background:#7fffd4;color:#000}.WEATHER{color:#7fffd4}"
-  ".fbtn.active.TRANSDUCER{background:#ffa500;color:#000}.TRANSDUCER{color:#ffa500}"
-  ".fbtn.active.OTROS{background:#aaa;color:#000}.OTROS{color:#aaa}"
-  "footer{text-align:center;color:#666;font-size:12px;margin-top:10px}</style></head><body>");
-
-  html += F("<select id='lang' class='lang' onchange='setLang(this.value)'><option value='en'>EN</option><option value='es'>ES</option><option value='fr'>FR</option></select>"
-            "<h2 id='title'>NMEA Reader</h2><div class='btnc' id='filterC'></div><div id='console'></div>");
-
-  // baud
-  html += "<div class='btnc'>";
-  for(int i=0;i<4;i++){
-    html += "<button type='button' id='baud_"+String(baudRates[i])+"' class='btn baud' onclick='setBaud("+String(baudRates[i])+")'>"+String(baudRates[i])+"</button>";
-  }
-  html += "</div>";
-
-  // start/clear
-  html += "<div class='btnc'><button type='button' id='pauseBtn' class='btn' onclick='togglePause()'>▶ Start</button>"
-          "<button type='button' id='clearBtn' class='btn' onclick='clearConsole()'>🧹 Clear</button></div>";
-
-  // speed
-  html += "<div class='btnc'>"
-          "<button type='button' class='btn' onclick='setSpeed(0.25,this)'>25%</button>"
-          "<button type='button' class='btn active' onclick='setSpeed(0.5,this)'>50%</button>"
-          "<button type='button' class='btn' onclick='setSpeed(0.75,this)'>75%</button>"
-          "<button type='button' class='btn' onclick='setSpeed(1,this)'>100%</button></div>";
-
-  // nav
-  html += "<div class='btnc'><button type='button' class='btn' onclick='gotoGen()'>➡ NMEA Generator</button></div>"
-          "<div class='btnc'><button type='button' class='btn' onclick='gotoMenu()'>🏠 Main Menu</button></div>"
-          "<footer>© 2025 Matías Scuppa — by Themys</footer>";
-
-  html +=
-    "<script>"
-    "let lang=localStorage.getItem('lang')||'en';"
-    "const Lb={en:{pause:'⏸ Pause',resume:'▶ Start',clear:'🧹 Clear'},"
-    "es:{pause:'⏸ Pausar',resume:'▶ Iniciar',clear:'🧹 Limpiar'},"
-    "fr:{pause:'⏸ Pause',resume:'▶ Démarrer',clear:'🧹 Effacer'}};"
-    "const cat={"
-      "en:{GPS:'GPS',AIS:'AIS',SOUNDER:'SOUNDER',VELOCITY:'VELOCITY',HEADING:'HEADING',RADAR:'RADAR',WEATHER:'WEATHER',TRANSDUCER:'TRANSDUCER',OTROS:'OTHER'},"
-      "es:{GPS:'GPS',AIS:'AIS',SOUNDER:'ECOSONDA',VELOCITY:'VELOCIDAD',HEADING:'RUMBO',RADAR:'RADAR',WEATHER:'METEO',TRANSDUCER:'TRANSDUCTOR',OTROS:'OTROS'},"
-      "fr:{GPS:'GPS',AIS:'AIS',SOUNDER:'SONDEUR',VELOCITY:'VITESSE',HEADING:'CAP',RADAR:'RADAR',WEATHER:'MÉTÉO',TRANSDUCER:'TRANSDUCTEUR',OTROS:'AUTRES'}"
-    "};"
-    "let filters=['GPS','AIS','SOUNDER','VELOCITY','HEADING','RADAR','WEATHER','TRANSDUCER','OTROS'];let filtersState={};filters.forEach(f=>filtersState[f]=true);"
-    "let paused=true, intervalMs=1000, intervalId=null;"
-    "function setLang(l){lang=l;localStorage.setItem('lang',l);applyLang();}"
-    "function applyLang(){document.getElementById('pauseBtn').innerText=paused?Lb[lang].resume:Lb[lang].pause;document.getElementById('clearBtn').innerText=Lb[lang].clear;drawFilters();}"
-    "function drawFilters(){let c=document.getElementById('filterC');c.innerHTML='';filters.forEach(f=>{let b=document.createElement('button');b.type='button';b.className='fbtn '+f;if(filtersState[f])b.classList.add('active');b.innerText=cat[lang][f]||f;b.onclick=()=>{filtersState[f]=!filtersState[f];b.classList.toggle('active',filtersState[f]);};c.appendChild(b);});let all=document.createElement('button');all.type='button';all.className='fbtn';all.innerText='ALL/NONE';all.onclick=()=>{let any=Object.values(filtersState).some(v=>v);Object.keys(filtersState).forEach(k=>filtersState[k]=!any);drawFilters();};c.appendChild(all);}"
-    "function togglePause(){paused=!paused;applyLang();fetch('/setmonitor?state='+(paused?0:1)).catch(()=>{});}"
-    "function clearConsole(){document.getElementById('console').innerHTML='';fetch('/clearnmea').catch(()=>{});}"
-    "async function setBaud(b){await fetch('/setbaud?baud='+b).catch(()=>{});document.querySelectorAll('.baud').forEach(x=>x.classList.remove('active'));let el=document.getElementById('baud_'+b);if(el)el.classList.add('active');}"
-    "function setSpeed(mult,btn){document.querySelectorAll('.btn').forEach(b=>{if(b.innerText.includes('%'))b.classList.remove('active');});btn.classList.add('active');intervalMs=Math.max(100,Math.round(1000/mult));if(intervalId)clearInterval(intervalId);intervalId=setInterval(poll,intervalMs);}"
-    "function poll(){if(paused)return;fetch('/getnmea?ts='+Date.now()).then(r=>r.text()).then(t=>{let c=document.getElementById('console');let lines=t.trim()?t.trim().split('\\n'):[];"
-      "let out=lines.map(l=>{if(!l)return'';let lb=l.indexOf(']');let typ=(lb>0&&l[0]=='[')?l.substring(1,lb):'OTROS';if(!filtersState[typ])return null;"
-      "let rest=(lb>=0)?l.substring(lb+1):l;return '<span class=\"'+typ+'\">['+(cat[lang][typ]||typ)+']'+rest+'</span>';}).filter(Boolean).join('<br>');"
-      "c.innerHTML=out;c.scrollTop=c.scrollHeight;}).catch(()=>{});}"
-    "async function gotoGen(){paused=true;applyLang();try{await fetch('/setmonitor?state=0');await fetch('/setmode?m=generator');}catch(e){} location.href='/generator';}"
-    "async function gotoMenu(){paused=true;try{await fetch('/setmonitor?state=0');await fetch('/togglegen?state=0');}catch(e){} location.href='/';}"
-    "document.addEventListener('DOMContentLoaded',async()=>{await fetch('/setmode?m=monitor');try{const st=await (await fetch('/getstatus')).json();paused=!st.monRunning;applyLang();let b=document.getElementById('baud_'+(st.baud||4800));if(b)b.classList.add('active');}catch(e){applyLang();}intervalId=setInterval(poll,intervalMs);});"
-    "window.addEventListener('beforeunload',()=>{if(intervalId)clearInterval(intervalId);});"
-    "</script></body></html>";
-
-  noCache(); server.send(200,"text/html; charset=utf-8",html);
-}
-
-// ===== listas Generator (lado servidor) =====
-const char* SENSOR_LIST[]={"GPS","WEATHER","HEADING","SOUNDER","VELOCITY","RADAR","TRANSDUCER","AIS","CUSTOM"};
-const int SENSOR_COUNT_CONST=9;
-
-static void appendOption(String &out,const char* v,const String &selected){
-  out += "<option value='"; out += v; out += "'";
-  if(selected==v) out += " selected";
-  out += ">"; out += v; out += "</option>";
-}
-String optionsForSensorSelect(const String& current){
-  String s; for(int i=0;i<SENSOR_COUNT_CONST;i++){ const char* v=SENSOR_LIST[i];
-    s += "<option value='"; s += v; s += "'";
-    if(String(v)==current) s += " selected";
-    s += ">"; s += v; s += "</option>";
-  } return s;
-}
-String optionsForSentence(const String& sensor,const String& selected){
-  String out;
-  if(sensor=="GPS"){
-    const char* arr[]={"GLL","RMC","VTG","GGA","GSA","GSV","DTM","ZDA","GNS","GST","GBS","GRS","RMB","RTE","BOD","XTE"};
-    for(size_t i=0;i<sizeof(arr)/sizeof(arr[0]);i++) appendOption(out,arr[i],selected);
-  } else if(sensor=="WEATHER"){
-    const char* arr[]={"MWD","MWV","VWR","VWT","MTW","MTA","MMB","MHU","MDA"};
-    for(size_t i=0;i<sizeof(arr)/sizeof(arr[0]);i++) appendOption(out,arr[i],selected);
-  } else if(sensor=="HEADING"){
-    const char* arr[]={"HDG","HDT","HDM","THS","ROT","RSA"};
-    for(size_t i=0;i<sizeof(arr)/sizeof(arr[0]);i++) appendOption(out,arr[i],selected);
-  } else if(sensor=="SOUNDER"){
-    const char* arr[]={"DBT","DPT","DBK","DBS"};
-    for(size_t i=0;i<sizeof(arr)/sizeof(arr[0]);i++) appendOption(out,arr[i],selected);
-  } else if(sensor=="VELOCITY"){
-    const char* arr[]={"VHW","VLW","VBW"};
-    for(size_t i=0;i<sizeof(arr)/sizeof(arr[0]);i++) appendOption(out,arr[i],selected);
-  } else if(sensor=="RADAR"){
-    const char* arr[]={"TLL","TTM","TLB","OSD"};
-    for(size_t i=0;i<sizeof(arr)/sizeof(arr[0]);i++) appendOption(out,arr[i],selected);
-  } else if(sensor=="TRANSDUCER"){
-    const char* arr[]={"XDR"};
-    for(size_t i=0;i<sizeof(arr)/sizeof(arr[0]);i++) appendOption(out,arr[i],selected);
-  } else if(sensor=="AIS"){
-    const char* arr[]={"AIVDM","AIVDO"};
-    for(size_t i=0;i<sizeof(arr)/sizeof(arr[0]);i++) appendOption(out,arr[i],selected);
-  } else {
-    appendOption(out,"CUSTOM",selected);
-  }
-  if(out.length()==0) appendOption(out,"CUSTOM",selected);
-  return out;
+void handleMonitor(AsyncWebServerRequest* req){
+  sendPage(req,"/monitor.html");
 }
-String initialEditableForSlot(int i){
+
+// ============ GENERATOR ============
+String initialEditableForSlot(const GenSlotCfg& sl){
   String full;
-  if(slots[i].text.length()) full=slots[i].text;
+  if(sl.text[0]) full=sl.text;
   else {
-    if(slots[i].sensor=="CUSTOM"||slots[i].sentence=="CUSTOM"){
+    if(!strcmp(sl.sensor,"CUSTOM")||!strcmp(sl.sentence,"CUSTOM")){
       String payload="GPCUS,FIELD1,FIELD2";
       full="$"+payload+"*"+nmeaChecksum(payload);
-    } else full=generateSentence(slots[i].sensor,slots[i].sentence);
+    } else full=generateSentence(sl.sensor,sl.sentence);
   }
-  return htmlEscape(fullToEditable(full));
+  return fullToEditable(full);
 }
-
-// ============ GENERATOR ============
-void handleGenerator(){
-  otaActive = false;
-  String html = F("<!doctype html><html><head><meta charset='utf-8'><title>NMEA Generator</title>"
-  "<meta name='viewport' content='width=device-width, initial-scale=1.0'>"
-  "<style>body{font-family:system-ui,-apple-system,Segoe UI,Roboto,Helvetica,Arial,Noto Sans,Liberation Sans,sans-serif;background:#000;color:#0f0;margin:0;padding:10px}"
-  "h2{text-align:center;color:#0ff;margin:8px 0}"
-  ".grid{display:grid;grid-template-columns:1fr;gap:10px}"
-  ".card{border:1px solid #0f0;border-radius:8px;padding:8px;background:#000;text-align:left}"
-  "label{display:block;margin:6px 0 4px 0;font-weight:bold;text-align:left !important}"
-  ".col{display:flex;flex-direction:column;align-items:flex-start;text-align:left}"
-  ".label-inline{display:inline-flex;align-items:center;gap:8px;justify-content:flex-start;text-align:left}"
-  ".label-inline input[type=checkbox]{margin:0 6px 0 0;transform:scale(1.1);accent-color:#0f0}"
-  "select,input{width:100%;box-sizing:border-box;padding:6px;background:#111;color:#0f0;border:1px solid #0f0;border-radius:6px;text-align:left}"
-  ".row{display:flex;gap:10px;flex-wrap:wrap;align-items:flex-start;justify-content:flex-start}"
-  ".row>*{flex:1;min-width:220px;text-align:left}"
-  ".row.spaceTop{margin-top:8px}"
-  ".btn{padding:10px;background:#111;color:#0f0;border:1px solid #0f0;border-radius:8px;font-size:16px;cursor:pointer;text-align:center;display:inline-block;box-sizing:border-box;line-height:1.2}"
-  ".btn.small{padding:6px 8px;font-size:14px;border-radius:6px}"
-  ".btn.active{background:#0f0;color:#000;font-weight:bold}"
-  "#genconsole{width:100%;box-sizing:border-box;height:40vh;overflow:auto;border:1px solid #0f0;padding:5px;background:#000;margin-top:10px;font-family:ui-monospace,SFMono-Regular,Menlo,Consolas,'Liberation Mono',monospace}"
-  ".btn-row{display:flex;gap:6px;margin-top:10px;align-items:stretch}"
-  ".btn-row .start{flex:2}"
-  ".btn-row .clear{flex:1}"
-  ".btn-full{width:100%;display:block}"
-  "footer{text-align:center;color:#666;font-size:12px;margin-top:10px}"
-  "a.btn{text-decoration:none}"
-  "</style></head><body>");
-
-  html += "<h2 id='genTitle'>NMEA Generator</h2><div class='grid' id='slots'>";
-  for(int i=0;i<MAX_SLOTS;i++){
-    unsigned long ms=slotInterval[i];
-    bool a100=(ms==100),a500=(ms==500),a1000=(ms==1000),a2000=(ms==2000);
-    html += "<div class='card' id='slot_"+String(i)+"'>";
-
-    html += "  <div class='row'>";
-    html += "    <div class='col'>";
-    html += "      <label class='label-inline'><input type='checkbox' id='en_"+String(i)+"'"+(slots[i].enabled?" checked":"")+"><span class='lblSensor'>Sensor</span></label>";
-    html += "      <select id='sensor_"+String(i)+"'>"+optionsForSensorSelect(slots[i].sensor)+"</select>";
-    html += "    </div>";
-    html += "    <div class='col'>";
-    html += "      <label class='lblSentence'>Sentence type</label>";
-    html += "      <select id='sentence_"+String(i)+"'>"+optionsForSentence(slots[i].sensor,slots[i].sentence)+"</select>";
-    html += "    </div>";
-    html += "  </div>";
-
-    html += "  <div class='row spaceTop'><div style='flex:1 1 100%'><input id='text_"+String(i)+"' placeholder='$GPRMC,...' autocomplete='off' value='"+initialEditableForSlot(i)+"'></div></div>";
-
-    html += "  <div class='row spaceTop'><div style='flex:1 1 100%'><label class='lblIntervalSlot'>Interval</label><div id='intgrp_"+String(i)+"' class='row' style='gap:8px'>";
-    html += String("    <button type='button' class='btn small int-btn") + (a100? " active" : "") + "' onclick='setIntervalSlot(" + String(i) + ",100,this)'>0.1s</button>";
-    html += String("    <button type='button' class='btn small int-btn") + (a500? " active" : "") + "' onclick='setIntervalSlot(" + String(i) + ",500,this)'>0.5s</button>";
-    html += String("    <button type='button' class='btn small int-btn") + (a1000? " active" : "") + "' onclick='setIntervalSlot(" + String(i) + ",1000,this)'>1s</button>";
-    html += String("    <button type='button' class='btn small int-btn") + (a2000? " active" : "") + "' onclick='setIntervalSlot(" + String(i) + ",2000,this)'>2s</button>";
-    html += "  </div></div></div>";
-
-    html += "</div>";
-  }
-  html += "</div>";
-
-  // baud
-  html += "<label id='lblBaud'>Baudrate</label><div class='row'>";
-  for(int i=0;i<4;i++){
-    html += "<button type='button' id='gen_baud_"+String(baudRates[i])+"' class='btn gen-baud' onclick='setGenBaud("+String(baudRates[i])+",this)'>"+String(baudRates[i])+"</button>";
-  }
-  html += "</div>";
-
-  // visor + botones + NAV extra hacia MONITOR
-  html += "<div id='genconsole'></div>"
-          "<div class='btn-row'>"
-          "<button type='button' id='startBtn' class='btn start' onclick='toggleGen(event)'>▶ Iniciar</button>"
-          "<button type='button' id='clearBtn' class='btn clear' onclick='clearGen(event)'>🧹 Limpiar</button>"
-          "</div>"
-          "<div class='btn-row'><a class='btn btn-full' href='/monitor' onclick='try{fetch(\"/togglegen?state=0\");}catch(e){}'>⬅ NMEA Monitor</a></div>"
-          "<div class='btn-row'><a class='btn btn-full' href='/' onclick='try{fetch(\"/togglegen?state=0\");}catch(e){}'>🏠 Main Menu</a></div>";
-
-  html +=
-    "<script>"
-    "const sentencesBySensor={GPS:['GLL','RMC','VTG','GGA','GSA','GSV','DTM','ZDA','GNS','GST','GBS','GRS','RMB','RTE','BOD','XTE'],"
-    "WEATHER:['MWD','MWV','VWR','VWT','MTW','MTA','MMB','MHU','MDA'],HEADING:['HDG','HDT','HDM','THS','ROT','RSA'],"
-    "SOUNDER:['DBT','DPT','DBK','DBS'],VELOCITY:['VHW','VLW','VBW'],RADAR:['TLL','TTM','TLB','OSD'],TRANSDUCER:['XDR'],AIS:['AIVDM','AIVDO'],CUSTOM:[]};"
-    "let lang=localStorage.getItem('lang')||'en';"
-    "const L={en:{title:'NMEA Generator',sensor:'Sensor',sentenceSel:'Sentence type',sentenceInline:'Sentence',interval:'Interval',start:'▶ Start',pause:'⏸ Pause',clear:'🧹 Clear',back:'⬅ NMEA Monitor',baud:'Baudrate'},"
-    "es:{title:'NMEA Generator',sensor:'Sensor',sentenceSel:'Tipo de sentencia',sentenceInline:'Sentencia',interval:'Intervalo',start:'▶ Iniciar',pause:'⏸ Pausar',clear:'🧹 Limpiar',back:'⬅ NMEA Monitor',baud:'Baudrate'},"
-    "fr:{title:'NMEA Generator',sensor:'Capteur',sentenceSel:'Type de trame',sentenceInline:'Trame',interval:'Intervalle',start:'▶ Démarrer',pause:'⏸ Pause',clear:'🧹 Effacer',back:'⬅ NMEA Monitor',baud:'Baudrate'}};"
-    "function hex2(n){return n.toString(16).toUpperCase().padStart(2,'0');}"
-    "function csPayload(s){let cs=0;for(let i=0;i<s.length;i++){cs^=s.charCodeAt(i);}return hex2(cs);} "
-    "function buildFullFromEditor(str){ if(!str) return ''; str=str.trim(); let ch=null; if(str[0]==='$'||str[0]==='!'){ ch=str[0]; str=str.slice(1);} let up=str.toUpperCase(); if(!ch) ch=(up.startsWith('AIVDM')||up.startsWith('AIVDO'))?'!':'$'; let payload=str; return ch+payload+'*'+csPayload(payload);} "
-    "function refillSent(sensorSel,sentSel){sentSel.innerHTML='';const arr=sentencesBySensor[sensorSel.value]||[];if(arr.length===0){let o=document.createElement('option');o.value='CUSTOM';o.text='CUSTOM';sentSel.appendChild(o);}else{for(let i=0;i<arr.length;i++){let o=document.createElement('option');o.value=arr[i];o.text=arr[i];sentSel.appendChild(o);}}}"
-    "async function getStatus(){try{const r=await fetch('/getstatus');return await r.json();}catch(e){return {baud:4800,genRunning:false};}}"
-    "function initSlot(i){const en=document.getElementById('en_'+i),sensorSel=document.getElementById('sensor_'+i),sentSel=document.getElementById('sentence_'+i),txt=document.getElementById('text_'+i);"
-    " en.addEventListener('change',e=>{fetch('/gen_slot_enable?i='+i+'&en='+(e.target.checked?1:0)).catch(()=>{});});"
-    " sensorSel.addEventListener('change',async ()=>{refillSent(sensorSel,sentSel);const newSent=sentSel.value;try{await fetch('/gen_slot_sensor?i='+i+'&sensor='+sensorSel.value);await fetch('/gen_slot_sentence?i='+i+'&sentence='+newSent);const r=await fetch('/gen_slot_template?i='+i);const t=await r.text();const ch=(t&&(t[0]==='$'||t[0]==='!'))?t[0]:'';let s=t? t.slice(ch?1:0):'';let star=s.indexOf('*'); if(star>=0) s=s.slice(0,star);txt.value=(ch?s?ch+s:s:s);}catch(e){}});"
-    " sentSel.addEventListener('change',async ()=>{try{await fetch('/gen_slot_sentence?i='+i+'&sentence='+sentSel.value);const r=await fetch('/gen_slot_template?i='+i);const t=await r.text();const ch=(t&&(t[0]==='$'||t[0]==='!'))?t[0]:'';let s=t? t.slice(ch?1:0):'';let star=s.indexOf('*'); if(star>=0) s=s.slice(0,star);txt.value=(ch?s?ch+s:s:s);}catch(e){}});"
-    " txt.addEventListener('input',e=>{ if(e.target.value.indexOf('*')>=0){ e.target.value=e.target.value.replace(/\\*/g,''); } const full=buildFullFromEditor(e.target.value); fetch('/gen_slot_text',{method:'POST',headers:{'Content-Type':'application/x-www-form-urlencoded'},body:'i='+i+'&text='+encodeURIComponent(full)}).catch(()=>{});});"
-    "} "
-    "function setActive(sel,scope,el){(scope||document).querySelectorAll(sel).forEach(b=>b.classList.remove('active')); if(el) el.classList.add('active');}"
-    "function setIntervalSlot(i,ms,btn){fetch('/gen_slot_interval?i='+i+'&ms='+ms).then(()=>{const g=document.getElementById('intgrp_'+i);if(!g)return;setActive('.int-btn',g,btn);}).catch(()=>{});} "
-    "async function setGenBaud(b,btn){try{await fetch('/setbaud?baud='+b);setActive('.gen-baud',document,btn);}catch(e){}}"
-    "let running=false;"
-    "async function toggleGen(e){if(e)e.preventDefault();try{running=!running;const r=await fetch('/togglegen?state='+(running?'1':'0'));const t=await r.text();running=(t==='RUNNING');document.getElementById('startBtn').innerText=running?L[lang].pause:L[lang].start;}catch(err){}}"
-    "function clearGen(e){if(e)e.preventDefault();fetch('/cleargen').catch(()=>{});document.getElementById('genconsole').innerHTML='';}"
-    "function pollGen(){fetch('/getgen?ts='+Date.now()).then(r=>r.text()).then(t=>{let c=document.getElementById('genconsole');c.innerHTML=(t||'').split('\\n').join('<br>');c.scrollTop=c.scrollHeight;}).catch(()=>{});} setInterval(pollGen,300);"
-    "function applyLang(){document.getElementById('genTitle').innerText=L[lang].title;document.getElementById('startBtn').innerText=running?L[lang].pause:L[lang].start;document.getElementById('clearBtn').innerText=L[lang].clear;document.getElementById('lblBaud').innerText=L[lang].baud;document.querySelectorAll('.lblSensor').forEach(e=>e.innerText=L[lang].sensor);document.querySelectorAll('.lblSentence').forEach(e=>e.innerText=L[lang].sentenceSel);document.querySelectorAll('.lblIntervalSlot').forEach(e=>e.innerText=L[lang].interval);}"
-    "document.addEventListener('DOMContentLoaded',async()=>{fetch('/setmode?m=generator');lang=localStorage.getItem('lang')||'en';for(let i=0;i<"+ String(MAX_SLOTS) +";i++){initSlot(i);}const st=await getStatus();running=!!st.genRunning;applyLang();var b=document.getElementById('gen_baud_'+(st.baud||4800));if(b)b.classList.add('active');});"
-    "</script><footer>© 2025 Matías Scuppa — by Themys</footer></body></html>";
-
-  noCache(); server.send(200,"text/html; charset=utf-8",html);
+void handleGenerator(AsyncWebServerRequest* req){
+  sendPage(req,"/generator.html");
+}
+// Catálogo para el generador, en el orden de sensors[]: {"GPS":["GLL",...],...,"CUSTOM":[]}
+void handleSentences(AsyncWebServerRequest* req){
+  char buf[768];
+  BufWriter w(buf, sizeof(buf));
+  w.raw("{");
+  for(int i=0;i<SENSOR_COUNT;i++){
+    w.printf("%s\"%s\":[", i?",":"", sensors[i].name);
+    bool first = true;
+    for(const SentenceDef& d : SENTENCES){
+      if(strcmp(d.sensor, sensors[i].name)) continue;
+      w.printf("%s\"%s\"", first?"":",", d.code);
+      first = false;
+    }
+    w.raw("]");
+  }
+  w.raw("}");
+  sendNoCache(req,200,"application/json",buf);
+}
+String slotJson(int i, const GenSlotCfg& sl){
+  String json = "{\"i\":"+String(i);
+  json += ",\"en\":"; json += (sl.enabled?"true":"false");
+  json += ",\"sensor\":\""+jsonEscape(sl.sensor)+"\"";
+  json += ",\"sentence\":\""+jsonEscape(sl.sentence)+"\"";
+  json += ",\"text\":\""+jsonEscape(initialEditableForSlot(sl))+"\"";
+  json += ",\"ms\":"+String(sl.intervalMs)+"}";
+  return json;
+}
+// Estado de los slots para armar el editor en el cliente (dato dinámico → sin cache)
+void handleGenSlots(AsyncWebServerRequest* req){
+  GenConfig g = genSnapshot();
+  String json="[";
+  for(int i=0;i<MAX_SLOTS;i++){ if(i) json += ","; json += slotJson(i, g.slot[i]); }
+  json += "]";
+  sendNoCache(req,200,"application/json",json);
 }
 
 // ============ OTA ============
-void handleUpdatePage(){
-  generatorRunning=false; monitorRunning=false;
-  otaActive = true; // WARNING en OLED
-
-  // Contenedor verde y botón Main Menu igual al de Upload (mismo <button>, mismas clases)
-  String html = F(
-    "<!doctype html><html><head><meta charset='utf-8'><title>OTA Update</title>"
-    "<meta name='viewport' content='width=device-width, initial-scale=1.0'>"
-    "<style>"
-      "body{font-family:system-ui,-apple-system,Segoe UI,Roboto,Helvetica,Arial,Noto Sans,Liberation Sans,sans-serif;background:#000;color:#0f0;margin:0;padding:0}"
-      ".wrap{min-height:100vh;display:flex;align-items:center;justify-content:center;padding:20px;box-sizing:border-box}"
-      ".card{width:100%;max-width:680px;background:#002900;border:1px solid #0f0;border-radius:12px;padding:16px;box-sizing:border-box;margin:0 auto}"
-      "h2{text-align:center;color:#0ff;margin:8px 0 12px}"
-      ".warn{border:1px solid #ff0;color:#ff0;padding:8px;border-radius:8px;background:#111;margin:8px 0}"
-      "input[type=file]{width:100%;box-sizing:border-box;padding:8px;background:#111;color:#0f0;border:1px solid #0f0;border-radius:8px;margin:10px 0}"
-      ".btn{padding:10px;background:#111;color:#0f0;border:1px solid #0f0;border-radius:8px;font-size:16px;cursor:pointer;text-align:center;display:inline-block;box-sizing:border-box;line-height:1.2}"
-      ".btn:hover{background:#0f0;color:#000}"
-      ".btn-full{width:100%;display:block}"
-      "#status{margin-top:8px;color:#7fffd4;min-height:1.2em}"
-      "footer{text-align:center;color:#666;font-size:12px;margin-top:10px}"
-    "</style></head><body>"
-    "<div class='wrap'><div class='card'>"
-      "<h2 id='ttl'>OTA Update</h2>"
-      "<div class='warn'>⚠️ <b>Do not disconnect power</b> while the firmware is uploading.</div>"
-      "<input id='file' type='file' accept='.bin'>"
-      "<button type='button' class='btn btn-full' id='btnUp' onclick='doUpload()'>Upload</button>"
-      "<div id='status'></div>"
-      "<button type='button' class='btn btn-full' id='btnMenu' onclick=\"location.href='/'\">🏠 Main Menu</button>"
-      "<footer>© 2025 Matías Scuppa — by Themys</footer>"
-    "</div></div>"
-    "<script>"
-    "let lang=localStorage.getItem('lang')||'en';const T={"
-      "en:{title:'OTA Update',msg:'Select the firmware .bin file and upload. The device will reboot automatically.',upload:'Upload',menu:'🏠 Main Menu',ok:'Upload OK. Rebooting…',fail:'Upload failed.'},"
-      "es:{title:'Actualizar Firmware',msg:'Selecciona el archivo .bin y súbelo. El equipo se reiniciará automáticamente.',upload:'Subir',menu:'🏠 Menú Principal',ok:'Subida OK. Reiniciando…',fail:'Fallo en la subida.'},"
-      "fr:{title:'Mise à jour OTA',msg:'Sélectionnez le fichier .bin et téléversez-le. L’appareil redémarrera automatiquement.',upload:'Téléverser',menu:'🏠 Menu Principal',ok:'Téléversement OK. Redémarrage…',fail:'Échec du téléversement.'}"
-    "};"
-    "function apply(){document.getElementById('ttl').innerText=T[lang].title;document.getElementById('btnUp').innerText=T[lang].upload;document.getElementById('btnMenu').innerText=T[lang].menu;}apply();"
-    "function doUpload(){const f=document.getElementById('file').files[0];if(!f){document.getElementById('status').innerText='No file';return;}const fd=new FormData();fd.append('update',f,f.name);document.getElementById('status').innerText=T[lang].msg;fetch('/update',{method:'POST',body:fd}).then(r=>r.text()).then(t=>{if(t.trim()==='OK'){document.getElementById('status').innerText=T[lang].ok;setTimeout(()=>{location.href='/'},8000);}else{document.getElementById('status').innerText=T[lang].fail+' ('+t+')';}}).catch(()=>{document.getElementById('status').innerText=T[lang].fail;});}"
-    "</script></body></html>"
-  );
-  noCache(); server.send(200,"text/html; charset=utf-8",html);
+// Sin cortar el tráfico: el handler sólo copia a otaPool y encola; la flash la
+// escribe TaskOTA. El SHA-256 se calcula a medida que llegan los trozos; en una
+// imagen ESP con hash_appended los últimos 32 bytes son el SHA-256 del resto y
+// se comparan antes de marcar la partición como arrancable.
+void handleUpdatePage(AsyncWebServerRequest* req){
+  sendPage(req,"/update.html");
+}
+
+static bool parseSha256Hex(const String& hex, uint8_t out[32]){
+  if(hex.length()!=64) return false;
+  for(int i=0;i<32;i++) if(!parseHexByte(hex.substring(2*i, 2*i+2), out[i])) return false;
+  return true;
 }
 
-void handleUpdateUpload(){
-  HTTPUpload& up=server.upload();
-  if(up.status==UPLOAD_FILE_START){
-    generatorRunning=false; monitorRunning=false;
+// El cuerpo llega por trozos a medida que entra por TCP (sin buffer completo en RAM)
+void handleUpdateUpload(AsyncWebServerRequest* req, const String& filename, size_t index, uint8_t* data, size_t len, bool final){
+  if(index==0){
+    // Otro en curso, ya terminado (reinicio pendiente) o con trozos viejos en la cola: éste se ignora
+    if(otaPhase==OTA_RECEIVING || otaPhase==OTA_VERIFYING || otaPhase==OTA_OK || uxQueueMessagesWaiting(otaQueue)) return;
+    otaOwner = req;
+    otaHasExpected = req->hasArg("sha256") && parseSha256Hex(req->arg("sha256"), otaExpected);
+    otaTotal = req->contentLength();
+    otaReceived = otaWritten = 0;
+    otaStallMaxUs = otaStallOverFifo = otaGateMs = 0;
+    otaError = "";
+    otaPhase = OTA_RECEIVING;
+    otaAborting = false;
     otaActive = true;
-    Update.begin(UPDATE_SIZE_UNKNOWN);
-  } else if(up.status==UPLOAD_FILE_WRITE){
-    Update.write(up.buf, up.currentSize);
-  } else if(up.status==UPLOAD_FILE_END){
-    Update.end(true);
+    xSemaphoreTake(otaAckMux, portMAX_DELAY);  // TaskOTA lo suelta apenas termina un ack()
+    otaClient = req->client();
+    xSemaphoreGive(otaAckMux);
+    req->onDisconnect([](){
+      xSemaphoreTake(otaAckMux, portMAX_DELAY);
+      otaClient = nullptr;
+      xSemaphoreGive(otaAckMux);
+    });
+    OtaMsg m{OTA_MSG_BEGIN, 0, 0};
+    xQueueSend(otaQueue, &m, 0);               // la cola tiene lugar para todo el pool + control
+  }
+  if(req != otaOwner || otaPhase != OTA_RECEIVING || otaAborting) return;
+
+  // Contrapresión: este segmento queda sin confirmar hasta que TaskOTA libere trozos
+  req->client()->ackLater();
+  while(len){
+    uint8_t slot;
+    // Con la ventana acotada siempre hay lugar; si no (ventana mayor a la prevista), se corta
+    if(xQueueReceive(otaFree, &slot, 0) != pdTRUE){
+      otaAborting = true;
+      OtaMsg m{OTA_MSG_ABORT, 0, 0};
+      xQueueSend(otaQueue, &m, 0);
+      return;
+    }
+    size_t n = len < OTA_SLOT_SIZE ? len : OTA_SLOT_SIZE;
+    memcpy(otaPool[slot], data, n);
+    OtaMsg m{OTA_MSG_DATA, slot, (uint16_t)n};
+    xQueueSend(otaQueue, &m, 0);
+    data += n; len -= n;
+    otaReceived += n;
+  }
+  if(final){
+    OtaMsg m{OTA_MSG_END, 0, 0};
+    xQueueSend(otaQueue, &m, 0);
   }
 }
+// El resultado final lo da /otastatus: la verificación sigue en TaskOTA
+void handleUpdateDone(AsyncWebServerRequest* req){
+  const char* body = (req != otaOwner) ? "BUSY" : (otaPhase==OTA_FAIL ? "FAIL" : "RECEIVED");
+  AsyncWebServerResponse* res=req->beginResponse(req != otaOwner ? 409 : 200,"text/plain",body);
+  noCache(res); res->addHeader("Connection","close");
+  req->send(res);
+}
+
+void handleOtaStatus(AsyncWebServerRequest* req){
+  static const char* const PHASES[] = {"idle","receiving","verifying","ok","fail"};
+  char hex[65] = "";
+  if(otaPhase==OTA_OK || otaPhase==OTA_FAIL){
+    for(int i=0;i<32;i++) snprintf(hex+2*i, 3, "%02x", otaDigest[i]);
+  }
+  char b[400];
+  snprintf(b, sizeof(b),
+    "{\"state\":\"%s\",\"err\":\"%s\",\"total\":%lu,\"received\":%lu,\"written\":%lu,\"sha256\":\"%s\","
+    "\"stallMaxUs\":%lu,\"stallOverFifo\":%lu,\"gateMs\":%lu,\"uartOverflows\":%lu}",
+    PHASES[otaPhase], otaError, (unsigned long)otaTotal, (unsigned long)otaReceived, (unsigned long)otaWritten, hex,
+    (unsigned long)otaStallMaxUs, (unsigned long)otaStallOverFifo, (unsigned long)otaGateMs,
+    (unsigned long)statUartOvf.load(std::memory_order_relaxed));
+  sendNoCache(req,200,"application/json",b);
+}
+
+// ---------- escritura (TaskOTA) ----------
+static mbedtls_sha256_context otaSha;
+static uint8_t otaTail[32];          // últimos 32 bytes recibidos, todavía fuera del hash
+static uint8_t otaTailLen = 0;
+static bool    otaHashAppended = false;
+
+// Confirma lo retenido por ackLater() → el cliente vuelve a mandar.
+// all=false: sólo si en el pool entra otra ventana completa.
+static void otaAck(bool all){
+  if(!all && (int)uxQueueMessagesWaiting(otaFree) < OTA_WND_SLOTS) return;
+  xSemaphoreTake(otaAckMux, portMAX_DELAY);
+  if(otaClient) otaClient->ack(SIZE_MAX);      // ack() recorta a lo que quedó pendiente
+  xSemaphoreGive(otaAckMux);
+}
+
+static void otaFail(const char* err){
+  if(otaPhase==OTA_RECEIVING || otaPhase==OTA_VERIFYING) Update.abort();
+  otaError = err;
+  otaPhase = OTA_FAIL;
+  otaActive = false;
+}
+
+// Hash de todo menos los últimos 32 bytes (que quedan en otaTail)
+static void otaHash(const uint8_t* p, size_t n){
+  if(n >= sizeof(otaTail)){
+    mbedtls_sha256_update(&otaSha, otaTail, otaTailLen);
+    mbedtls_sha256_update(&otaSha, p, n - sizeof(otaTail));
+    memcpy(otaTail, p + n - sizeof(otaTail), sizeof(otaTail));
+    otaTailLen = sizeof(otaTail);
+    return;
+  }
+  size_t spill = (otaTailLen + n > sizeof(otaTail)) ? otaTailLen + n - sizeof(otaTail) : 0;
+  mbedtls_sha256_update(&otaSha, otaTail, spill);
+  memmove(otaTail, otaTail + spill, otaTailLen - spill);
+  memcpy(otaTail + otaTailLen - spill, p, n);
+  otaTailLen = otaTailLen - spill + n;
+}
+
+// Update.write() graba un sector (borrado + escritura, ~20–40 ms) cada 4 KB y durante
+// eso la caché está apagada: la ISR del UART no corre y sólo queda la FIFO de 128 B.
+// Esas escrituras se hacen entre sentencias, con el buffer del driver casi vacío.
+static const uint32_t UART_HW_FIFO = 128;
+static const uint32_t FLASH_SECTOR = 4096;     // buffer interno de Update
+static void otaGate(){
+  if(!(appMode==MODE_MONITOR && monitorRunning)) return;
+  uint32_t t0 = millis();
+  while(millis() - t0 < OTA_GATE_MAX_MS){
+    if(!lineRxUs && NMEA_Serial.available() < UART_RX_BUF/4) break;
+    vTaskDelay(1);
+  }
+  otaGateMs += millis() - t0;
+}
+
+static void otaWrite(uint8_t* p, size_t n){
+  if(otaWritten==0) otaHashAppended = (n > 23 && p[0]==0xE9 && p[23]==1);   // esp_image_header_t
+  otaHash(p, n);
+  const bool flushesSector = (otaWritten % FLASH_SECTOR) + n >= FLASH_SECTOR;
+  if(flushesSector) otaGate();
+  int64_t t0 = esp_timer_get_time();
+  size_t w = Update.write(p, n);
+  uint32_t dt = (uint32_t)(esp_timer_get_time() - t0);
+  if(dt > otaStallMaxUs) otaStallMaxUs = dt;
+  if(appMode==MODE_MONITOR && monitorRunning && dt > UART_HW_FIFO * 10000000UL / currentBaud) otaStallOverFifo++;
+  if(w != n){ otaFail(Update.errorString()); return; }
+  otaWritten += n;
+}
+
+static void otaFinish(){
+  otaPhase = OTA_VERIFYING;
+  mbedtls_sha256_context img;
+  mbedtls_sha256_init(&img);
+  mbedtls_sha256_clone(&img, &otaSha);
+  uint8_t imgDigest[32];
+  mbedtls_sha256_finish(&img, imgDigest);
+  mbedtls_sha256_free(&img);
+  mbedtls_sha256_update(&otaSha, otaTail, otaTailLen);
+  mbedtls_sha256_finish(&otaSha, otaDigest);
+  mbedtls_sha256_free(&otaSha);
+
+  if(otaHashAppended && (otaTailLen != 32 || memcmp(imgDigest, otaTail, 32))){ otaFail("image sha256"); return; }
+  if(otaHasExpected && memcmp(otaDigest, otaExpected, 32)){ otaFail("sha256 mismatch"); return; }
+  if(!Update.end(true)){ otaFail(Update.errorString()); return; }
+  otaPhase = OTA_OK;
+  rebootAtMs = millis() + 1500;   // tiempo para que la página lea "ok" en /otastatus
+}
 
 // ============ API Monitor/Gen ============
-void handleToggleGen(){ if(server.hasArg("state")) generatorRunning = (server.arg("state")=="1"); otaActive=false; noCache(); server.send(200,"text/plain",generatorRunning?"RUNNING":"STOPPED"); }
-void handleGetGen(){
-  String out;
+void handleToggleGen(AsyncWebServerRequest* req){ if(req->hasArg("state")) generatorRunning = (req->arg("state")=="1"); markConfigDirty(); sendNoCache(req,200,"text/plain",generatorRunning?"RUNNING":"STOPPED"); }
+// ?since=<seq>: sólo las líneas nuevas, con encabezado "<seq> <perdidas>"
+void handleGetGen(AsyncWebServerRequest* req){
+  uint32_t t0 = webDataBegin(req);
+  if(!t0) return;
+  String out; uint32_t n = 0; uint16_t rate;
   xSemaphoreTake(genBufMutex,portMAX_DELAY);
-  for(int i=0;i<GEN_BUFFER_LINES;i++){ int idx=(genIndex+i)%GEN_BUFFER_LINES; if(genBuffer[idx].length()>0) out+=genBuffer[idx]+"\n"; }
+  out  = req->hasArg("since") ? genConsole.since((uint32_t)req->arg("since").toInt(), &n) : genConsole.all();
+  rate = genConsole.rate(millis());
   xSemaphoreGive(genBufMutex);
-  noCache(); server.send(200,"text/plain",out);
-}
-void handleClearGen(){ xSemaphoreTake(genBufMutex,portMAX_DELAY); for(int i=0;i<GEN_BUFFER_LINES;i++) genBuffer[i]=""; genIndex=0; xSemaphoreGive(genBufMutex); noCache(); server.send(200,"text/plain","OK"); }
-void handleSetMode(){ String m=server.hasArg("m")?server.arg("m"):"monitor"; appMode=(m=="generator")?MODE_GENERATOR:MODE_MONITOR; generatorRunning=false; monitorRunning=false; otaActive=false; noCache(); server.send(200,"text/plain",(appMode==MODE_GENERATOR)?"GENERATOR":"MONITOR"); }
-void handleSetMonitor(){ if(server.hasArg("state")) monitorRunning=(server.arg("state")=="1"); otaActive=false; noCache(); server.send(200,"text/plain",monitorRunning?"RUNNING":"PAUSED"); }
-void handleGetNMEA(){
-  String out; xSemaphoreTake(nmeaBufMutex,portMAX_DELAY);
-  for(int i=0;i<BUFFER_LINES;i++){ int idx=(bufferIndex+i)%BUFFER_LINES; if(nmeaBuffer[idx].length()>0) out+=nmeaBuffer[idx]+"\n"; }
+  sendConsole(req, out, n, pollHintMs(rate, GEN_BUFFER_LINES));
+  webDataEnd(t0);
+}
+void handleClearGen(AsyncWebServerRequest* req){ xSemaphoreTake(genBufMutex,portMAX_DELAY); genConsole.clear(); xSemaphoreGive(genBufMutex); sendNoCache(req,200,"text/plain","OK"); }
+void handleSetMode(AsyncWebServerRequest* req){ String m=req->hasArg("m")?req->arg("m"):"monitor"; appMode=(m=="generator")?MODE_GENERATOR:MODE_MONITOR; generatorRunning=false; monitorRunning=false; markConfigDirty(); sendNoCache(req,200,"text/plain",(appMode==MODE_GENERATOR)?"GENERATOR":"MONITOR"); }
+void handleSetMonitor(AsyncWebServerRequest* req){ if(req->hasArg("state")) monitorRunning=(req->arg("state")=="1"); markConfigDirty(); sendNoCache(req,200,"text/plain",monitorRunning?"RUNNING":"PAUSED"); }
+void handleGetNMEA(AsyncWebServerRequest* req){
+  uint32_t t0 = webDataBegin(req);
+  if(!t0) return;
+  String out; uint32_t n = 0; uint16_t rate;
+  xSemaphoreTake(nmeaBufMutex,portMAX_DELAY);
+  out  = req->hasArg("since") ? nmeaConsole.since((uint32_t)req->arg("since").toInt(), &n) : nmeaConsole.all();
+  rate = nmeaConsole.rate(millis());
   xSemaphoreGive(nmeaBufMutex);
-  noCache(); server.send(200,"text/plain",out);
-}
-void handleSetBaud(){ noCache(); if(server.hasArg("baud")){ int b=server.arg("baud").toInt(); if(b==4800||b==9600||b==38400||b==115200) startSerial(b); server.send(200,"text/plain","OK"); } else server.send(400,"text/plain","Error"); }
-void handleClearNMEA(){ xSemaphoreTake(nmeaBufMutex,portMAX_DELAY); for(int i=0;i<BUFFER_LINES;i++) nmeaBuffer[i]=""; bufferIndex=0; currentLine=""; lineStartMs=0; xSemaphoreGive(nmeaBufMutex); noCache(); server.send(200,"text/plain","OK"); }
-
-int argIndex(){ if(!server.hasArg("i")) return -1; int i=server.arg("i").toInt(); if(i<0||i>=MAX_SLOTS) return -1; return i; }
-void handleGenSlotEnable(){ int i=argIndex(); if(i<0){server.send(400,"text/plain","Bad slot");return;} bool en=server.hasArg("en")&&(server.arg("en").toInt()==1); slots[i].enabled=en; server.send(200,"text/plain",en?"1":"0"); }
-void handleGenSlotSensor(){ int i=argIndex(); if(i<0){server.send(400,"text/plain","Bad slot");return;} if(server.hasArg("sensor")){ slots[i].sensor=server.arg("sensor"); if(slots[i].sensor=="CUSTOM") slots[i].sentence="CUSTOM"; } server.send(200,"text/plain",slots[i].sensor); }
-void handleGenSlotSentence(){ int i=argIndex(); if(i<0){server.send(400,"text/plain","Bad slot");return;} if(server.hasArg("sentence")) slots[i].sentence=server.arg("sentence"); server.send(200,"text/plain",slots[i].sentence); }
-void handleGenSlotText_POST(){ int i=-1; if(server.hasArg("i")) i=server.arg("i").toInt(); if(i<0||i>=MAX_SLOTS){server.send(400,"text/plain","Bad slot");return;} String incoming=server.hasArg("text")?server.arg("text"):""; slots[i].text=incoming; server.send(200,"text/plain",incoming); }
-void handleGenSlotText_GET(){ int i=argIndex(); if(i<0){server.send(400,"text/plain","Bad slot");return;} String incoming=server.hasArg("text")?server.arg("text"):""; slots[i].text=incoming; server.send(200,"text/plain",incoming); }
-void handleGenSlotTemplate(){ int i=argIndex(); if(i<0){server.send(400,"text/plain","Bad slot");return;} String t; if(slots[i].sensor=="CUSTOM"||slots[i].sentence=="CUSTOM"){ t=slots[i].text.length()?slots[i].text:"$GPCUS,FIELD1,FIELD2*00"; if(t.startsWith("$")||t.startsWith("!")){ int star=t.indexOf('*'); String payload=(star>=0)?t.substring(1,star):t.substring(1); t=String(t[0])+payload+"*"+nmeaChecksum(payload);} else { String up=t; up.toUpperCase(); char ch=(up.startsWith("AIVDM")||up.startsWith("AIVDO"))?'!':'$'; String payload=t; t=String(ch)+payload+"*"+nmeaChecksum(payload);} } else { t=generateSentence(slots[i].sensor,slots[i].sentence); } slots[i].text=t; server.send(200,"text/plain",t); }
-void handleGenSlotInterval(){ int i=argIndex(); if(i<0){server.send(400,"text/plain","Bad slot");return;} if(!server.hasArg("ms")){server.send(400,"text/plain","Missing ms");return;} long ms=server.arg("ms").toInt(); if(ms<50) ms=50; slotInterval[i]=(unsigned long)ms; server.send(200,"text/plain",String(slotInterval[i])); }
-void handleGetStatus(){
+  sendConsole(req, out, n, pollHintMs(rate, BUFFER_LINES));
+  webDataEnd(t0);
+}
+// Sólo valida y encarga: reabrir el UART (mutex + delay) lo hace TaskNMEA, no la tarea de AsyncTCP
+void handleSetBaud(AsyncWebServerRequest* req){ if(req->hasArg("baud")){ int b=req->arg("baud").toInt(); if(b==4800||b==9600||b==38400||b==115200) { baudRequest.store(b, std::memory_order_relaxed); markConfigDirty(); } sendNoCache(req,200,"text/plain","OK"); } else sendNoCache(req,400,"text/plain","Error"); }
+void handleClearNMEA(AsyncWebServerRequest* req){ xSemaphoreTake(nmeaBufMutex,portMAX_DELAY); nmeaConsole.clear(); xSemaphoreGive(nmeaBufMutex); sendNoCache(req,200,"text/plain","OK"); }
+
+int argIndex(AsyncWebServerRequest* req){ if(!req->hasArg("i")) return -1; int i=req->arg("i").toInt(); if(i<0||i>=MAX_SLOTS) return -1; return i; }
+String templateForSlot(const GenSlotCfg& sl){
+  String t;
+  if(!strcmp(sl.sensor,"CUSTOM")||!strcmp(sl.sentence,"CUSTOM")){
+    t=sl.text[0]?String(sl.text):String("$GPCUS,FIELD1,FIELD2*00");
+    if(t.startsWith("$")||t.startsWith("!")){ int star=t.indexOf('*'); String payload=(star>=0)?t.substring(1,star):t.substring(1); t=String(t[0])+payload+"*"+nmeaChecksum(payload);}
+    else { String up=t; up.toUpperCase(); char ch=(up.startsWith("AIVDM")||up.startsWith("AIVDO"))?'!':'$'; String payload=t; t=String(ch)+payload+"*"+nmeaChecksum(payload);}
+  } else {
+    t=generateSentence(sl.sensor,sl.sentence);
+  }
+  return t;
+}
+// Aplica fn al slot i sobre una copia, publica y devuelve el slot resultante
+template<class F> GenSlotCfg updateSlot(int i, F fn){
+  GenSlotCfg out;
+  genUpdate([&](GenConfig& g){ fn(g.slot[i]); out = g.slot[i]; });
+  markConfigDirty();
+  return out;
+}
+void handleGenSlotEnable(AsyncWebServerRequest* req){ int i=argIndex(req); if(i<0){req->send(400,"text/plain","Bad slot");return;} bool en=req->hasArg("en")&&(req->arg("en").toInt()==1); updateSlot(i,[&](GenSlotCfg& s){ s.enabled=en; }); req->send(200,"text/plain",en?"1":"0"); }
+void handleGenSlotSensor(AsyncWebServerRequest* req){ int i=argIndex(req); if(i<0){req->send(400,"text/plain","Bad slot");return;} GenSlotCfg r=genSnapshot().slot[i]; if(req->hasArg("sensor")){ String v=req->arg("sensor"); r=updateSlot(i,[&](GenSlotCfg& s){ SET_STR(s.sensor,v.c_str()); if(v=="CUSTOM") SET_STR(s.sentence,"CUSTOM"); }); } req->send(200,"text/plain",r.sensor); }
+void handleGenSlotSentence(AsyncWebServerRequest* req){ int i=argIndex(req); if(i<0){req->send(400,"text/plain","Bad slot");return;} GenSlotCfg r=genSnapshot().slot[i]; if(req->hasArg("sentence")){ String v=req->arg("sentence"); r=updateSlot(i,[&](GenSlotCfg& s){ SET_STR(s.sentence,v.c_str()); }); } req->send(200,"text/plain",r.sentence); }
+void handleGenSlotText(AsyncWebServerRequest* req){ int i=argIndex(req); if(i<0){req->send(400,"text/plain","Bad slot");return;} String incoming=req->hasArg("text")?req->arg("text"):""; updateSlot(i,[&](GenSlotCfg& s){ SET_STR(s.text,incoming.c_str()); }); req->send(200,"text/plain",incoming); }
+void handleGenSlotTemplate(AsyncWebServerRequest* req){ int i=argIndex(req); if(i<0){req->send(400,"text/plain","Bad slot");return;} String t; updateSlot(i,[&](GenSlotCfg& s){ t=templateForSlot(s); SET_STR(s.text,t.c_str()); }); req->send(200,"text/plain",t); }
+void handleGenSlotInterval(AsyncWebServerRequest* req){ int i=argIndex(req); if(i<0){req->send(400,"text/plain","Bad slot");return;} if(!req->hasArg("ms")){req->send(400,"text/plain","Missing ms");return;} long ms=req->arg("ms").toInt(); if(ms<50) ms=50; if(ms>60000) ms=60000; updateSlot(i,[&](GenSlotCfg& s){ s.intervalMs=(uint16_t)ms; }); req->send(200,"text/plain",String(ms)); }
+// POST /gen_slot  {"i":0,"en":true,"sensor":"GPS","sentence":"RMC","text":"$GP...*hh","ms":500,"tpl":false}
+// Aplica el slot completo en una sola publicación (sin estados intermedios en el TX loop).
+// "tpl":true → regenera la plantilla para sensor/sentence y la devuelve.
+void handleGenSlotJson(AsyncWebServerRequest* req, JsonVariant& json){
+  int i = json["i"] | -1;
+  if(i<0||i>=MAX_SLOTS){ req->send(400,"text/plain","Bad slot"); return; }
+  GenSlotCfg r = updateSlot(i,[&](GenSlotCfg& s){
+    if(json["en"].is<bool>())              s.enabled = json["en"].as<bool>();
+    if(json["sensor"].is<const char*>())   SET_STR(s.sensor,   json["sensor"].as<const char*>());
+    if(json["sentence"].is<const char*>()) SET_STR(s.sentence, json["sentence"].as<const char*>());
+    if(json["text"].is<const char*>())     SET_STR(s.text,     json["text"].as<const char*>());
+    if(!strcmp(s.sensor,"CUSTOM")) SET_STR(s.sentence,"CUSTOM");
+    long ms = json["ms"] | (long)s.intervalMs;
+    s.intervalMs = (uint16_t)constrain(ms, 50L, 60000L);
+    if(json["tpl"] | false) SET_STR(s.text, templateForSlot(s).c_str());
+  });
+  sendNoCache(req,200,"application/json",slotJson(i, r));
+}
+void handleGetStatus(AsyncWebServerRequest* req){
   String json="{";
   json += "\"mode\":\""+String(appMode==MODE_GENERATOR?"generator":"monitor")+"\","; // para front
   json += "\"baud\":"+String(currentBaud)+",";
   json += "\"genRunning\":"; json += (generatorRunning?"true":"false"); json += ",";
-  json += "\"monRunning\":"; json += (monitorRunning?"true":"false");
+  json += "\"monRunning\":"; json += (monitorRunning?"true":"false"); json += ",";
+  json += "\"filters\":"+String(outCatMask[OUT_WEB])+",";
+  json += "\"autoResume\":"; json += (cfgAutoResume?"true":"false"); json += ",";
+  json += "\"skipSplash\":"; json += (cfgSkipSplash?"true":"false"); json += ",";
+  json += "\"dedup\":"; json += (cfgDedup?"true":"false"); json += ",";
+  json += "\"dedupWinMs\":"+String(dedupWindowMs)+",";
+  json += "\"dedupKaMs\":"+String(dedupKeepAliveMs)+",";
+  json += "\"rxLines\":"+String(statRxLines.load(std::memory_order_relaxed))+",";
+  json += "\"dedupSuppressed\":"+String(statDedup.load(std::memory_order_relaxed))+",";
+  json += "\"skWs\":"; json += (cfgSkWs?"true":"false"); json += ",";
+  json += "\"skUdp\":"; json += (cfgSkUdp?"true":"false"); json += ",";
+  json += "\"skClients\":"+String(skWs.count())+",";
+  json += "\"skDeltas\":"+String(skDeltas.load(std::memory_order_relaxed))+",";
+  json += "\"iec450\":"; json += (cfgIec450?"true":"false"); json += ",";
+  json += "\"iecSrc\":\""+String(iecSrc)+"\",";
+  json += "\"iecDatagrams\":"+String(iecDatagrams.load(std::memory_order_relaxed))+",";
+  json += "\"iecLines\":"+String(iecLines.load(std::memory_order_relaxed))+",";
+  json += "\"rxTag\":"; json += (cfgRxTag?"true":"false"); json += ",";
+  json += "\"uartOvf\":"+String(statUartOvf.load(std::memory_order_relaxed))+",";
+  uint32_t shows = ledShows.load(std::memory_order_relaxed);
+  json += "\"ledShows\":"+String(shows)+",";
+  json += "\"ledShowAvgUs\":"+String(shows ? ledShowUs.load(std::memory_order_relaxed)/shows : 0)+",";
+  json += "\"histBytes\":"+String(histSize)+",";
+  json += "\"histPsram\":"; json += (histPsram?"true":"false"); json += ",";
+  json += "\"histCount\":"+String(histCount.load(std::memory_order_relaxed))+",";
+  json += "\"webBusy\":"+String(webLoad.busyPct)+",\"webShed\":"+String(webLoad.shed)+",";
+  const N2kToNmea::Stats& ns = n2k.stats();
+  json += "\"n2k\":"; json += (cfgN2k?"true":"false"); json += ",";
+  json += "\"n2kBus\":"; json += (n2kBusUp?"true":"false"); json += ",";
+  json += "\"n2kFrames\":"+String(ns.frames)+",\"n2kDecoded\":"+String(ns.decoded)+",";
+  json += "\"n2kFpDropped\":"+String(ns.fpDropped)+",\"n2kQueueDrops\":"+String(n2kQueueDrops.load(std::memory_order_relaxed));
   json += "}";
-  noCache(); server.send(200,"application/json",json);
+  sendNoCache(req,200,"application/json",json);
+}
+
+static void rateJson(String& json, const RateStat& r, uint32_t now){
+  uint32_t n   = r.count.load(std::memory_order_relaxed);
+  uint32_t ivl = r.ivlQ4.load(std::memory_order_relaxed);
+  char b[128];
+  snprintf(b, sizeof(b), "\"n\":%lu,\"hz\":%.1f,\"jitMs\":%lu,\"maxGapMs\":%lu,\"ageMs\":%lu,\"state\":\"%s\"",
+           (unsigned long)n, ivl ? 16000.0f/ivl : 0.0f,
+           (unsigned long)(r.jitQ4.load(std::memory_order_relaxed) >> 4),
+           (unsigned long)r.maxGap.load(std::memory_order_relaxed),
+           (unsigned long)(n ? now - r.lastMs.load(std::memory_order_relaxed) : 0),
+           stateName(rateState(r, now)));
+  json += b;
+}
+
+// Ritmo, jitter, hueco máximo y alarma de silencio por categoría y por ID
+void handleStreams(AsyncWebServerRequest* req){
+  uint32_t now = millis();
+  String json = "{\"cats\":[";
+  for(int i=0;i<SENSOR_COUNT;i++){
+    if(i) json += ",";
+    json += "{\"name\":\""; json += sensors[i].name; json += "\",";
+    rateJson(json, sensors[i].rx, now);
+    json += "}";
+  }
+  json += "],\"ids\":[";
+  bool first = true;
+  for(int i=0;i<STREAM_MAX;i++){
+    if(!streams[i].key.load(std::memory_order_acquire)) continue;
+    if(!first) json += ",";
+    first = false;
+    json += "{\"id\":\""; json += streams[i].id; json += "\",\"cat\":\"";
+    json += streams[i].cat>=0 ? sensors[streams[i].cat].name : "OTROS"; json += "\",";
+    rateJson(json, streams[i].rx, now);
+    json += ",\"dup\":" + String(streams[i].suppressed.load(std::memory_order_relaxed));
+    json += "}";
+  }
+  json += "],\"dedup\":" + String(statDedup.load(std::memory_order_relaxed));
+  json += ",\"overflow\":" + String(streamOverflow.load(std::memory_order_relaxed)) + "}";
+  sendNoCache(req,200,"application/json",json);
+}
+
+// Estado de navegación: sólo datos vistos alguna vez, con su antigüedad (ms)
+static void vesselField(BufWriter& w, const char* name, uint32_t t, uint32_t now, bool& first){
+  if(!first) w.raw(",");
+  first = false;
+  w.printf("\"%s\":{\"age\":%lu", name, (unsigned long)(now - t));
+}
+void handleVessel(AsyncWebServerRequest* req){
+  static char buf[1024];
+  const VesselState v = vesselSnapshot();
+  const uint32_t now = millis();
+  BufWriter w(buf, sizeof(buf));
+  bool first = true;
+  w.raw("{");
+  if(v.tPos){      vesselField(w,"pos",v.tPos,now,first);   w.raw(",\"lat\":"); w.fixed(v.latE7,7); w.raw(",\"lon\":"); w.fixed(v.lonE7,7); w.raw("}"); }
+  if(v.tSog){      vesselField(w,"sog",v.tSog,now,first);   w.raw(",\"kn\":");  w.fixed(v.sogKn100,2); w.raw("}"); }
+  if(v.tCog){      vesselField(w,"cog",v.tCog,now,first);   w.raw(",\"deg\":"); w.fixed(v.cogDeg100,2); w.raw("}"); }
+  if(v.tHdgTrue){  vesselField(w,"hdgTrue",v.tHdgTrue,now,first); w.raw(",\"deg\":"); w.fixed(v.hdgTrueDeg100,2); w.raw("}"); }
+  if(v.tHdgMag){   vesselField(w,"hdgMag",v.tHdgMag,now,first);   w.raw(",\"deg\":"); w.fixed(v.hdgMagDeg100,2); w.raw("}"); }
+  if(v.tDepth){
+    DepthRef ref = depthRef(v);
+    vesselField(w,"depth",v.tDepth,now,first);
+    w.printf(",\"ref\":\"%s\",\"m\":", DEPTH_REF_NAME[ref]); w.fixed(depthShownM100(v),2);
+    if(ref != DEPTH_XDR){ w.raw(",\"belowTransducer\":"); w.fixed(v.depthM100,2); w.raw(",\"off\":"); w.fixed(v.depthOffM100,2); }
+    w.raw("}");
+  }
+  if(v.tAppWind){  vesselField(w,"appWind",v.tAppWind,now,first); w.raw(",\"deg\":"); w.fixed(v.awaDeg100,2); w.raw(",\"kn\":"); w.fixed(v.awsKn100,2); w.raw("}"); }
+  if(v.tTrueWind){ vesselField(w,"trueWind",v.tTrueWind,now,first); w.raw(",\"deg\":"); w.fixed(v.twaDeg100,2); w.raw(",\"kn\":"); w.fixed(v.twsKn100,2); w.raw("}"); }
+  if(v.tWaterTemp){vesselField(w,"waterTemp",v.tWaterTemp,now,first); w.raw(",\"c\":"); w.fixed(v.waterTempC100,2); w.raw("}"); }
+  if(v.tAirTemp){  vesselField(w,"airTemp",v.tAirTemp,now,first);     w.raw(",\"c\":"); w.fixed(v.airTempC100,2); w.raw("}"); }
+  if(v.tFix){      vesselField(w,"fix",v.tFix,now,first); w.printf(",\"q\":%u,\"sats\":%u,\"hdop\":", v.fixQuality, v.sats); w.fixed(v.hdop100,2); w.raw("}"); }
+  if(v.tTime){     vesselField(w,"utc",v.tTime,now,first); w.printf(",\"time\":\"%06ld\",\"date\":\"%06ld\"}", (long)(v.utcTimeCs/100), (long)v.dateDdmmyy); }
+  if(!first) w.raw(",");
+  w.printf("\"parse\":{\"n\":%lu,\"maxCycles\":%lu,\"overBudget\":%lu}}",
+           (unsigned long)parsedCount.load(std::memory_order_relaxed), (unsigned long)parseMaxCycles, (unsigned long)parseOverBudget);
+  sendNoCache(req,200,"application/json",buf);
+}
+
+// Histograma de latencia RX → UDP (GET /latency, ?reset=1 lo pone en cero)
+void handleLatency(AsyncWebServerRequest* req){
+  if(req->hasArg("reset")){
+    for(auto& h : latHist) h.store(0, std::memory_order_relaxed);
+    latMaxUs.store(0, std::memory_order_relaxed);
+  }
+  uint32_t h[LAT_BUCKETS], n = 0;
+  for(int i=0;i<LAT_BUCKETS;i++){ h[i] = latHist[i].load(std::memory_order_relaxed); n += h[i]; }
+  // Percentiles como cota superior del bucket que los contiene
+  auto pct = [&](uint32_t p)->uint32_t{
+    if(!n) return 0;
+    uint32_t want = (n*(uint64_t)p + 99)/100, acc = 0;
+    for(int i=0;i<LAT_BUCKETS;i++){ acc += h[i]; if(acc >= want) return 64u<<i; }
+    return 64u<<(LAT_BUCKETS-1);
+  };
+  char buf[640];
+  BufWriter w(buf, sizeof(buf));
+  w.printf("{\"n\":%lu,\"maxUs\":%lu,\"p50Us\":%lu,\"p90Us\":%lu,\"p99Us\":%lu,\"buckets\":[",
+           (unsigned long)n, (unsigned long)latMaxUs.load(std::memory_order_relaxed),
+           (unsigned long)pct(50), (unsigned long)pct(90), (unsigned long)pct(99));
+  for(int i=0;i<LAT_BUCKETS;i++) w.printf("%s[%lu,%lu]", i?",":"", (unsigned long)(64u<<i), (unsigned long)h[i]);
+  w.raw("]}");
+  sendNoCache(req,200,"application/json",buf);
+}
+
+// Etapas del pipeline (GET /pipeline, ?reset=1 pone en cero picos y promedios)
+static void pipeStageJson(BufWriter& w, const char* name, BaseType_t core, BaseType_t prio,
+                          const SpscRing<PipeRec*, PIPE_POOL>& q, const PipeStage& st){
+  uint32_t n = st.n.load(std::memory_order_relaxed);
+  w.printf("{\"name\":\"%s\",\"core\":%d,\"prio\":%d,\"depth\":%lu,\"peak\":%lu,\"n\":%lu,"
+           "\"waitAvgUs\":%lu,\"waitMaxUs\":%lu,\"workAvgUs\":%lu,\"workMaxUs\":%lu}",
+           name, (int)core, (int)prio, (unsigned long)q.depth(), (unsigned long)q.peak.load(std::memory_order_relaxed), (unsigned long)n,
+           (unsigned long)(n ? st.waitUs.load(std::memory_order_relaxed)/n : 0), (unsigned long)st.waitMaxUs.load(std::memory_order_relaxed),
+           (unsigned long)(n ? st.workUs.load(std::memory_order_relaxed)/n : 0), (unsigned long)st.workMaxUs.load(std::memory_order_relaxed));
+}
+void handlePipeline(AsyncWebServerRequest* req){
+  if(req->hasArg("reset")){
+    for(PipeStage* st : {&pipeProcStat, &pipeOutStat}){
+      st->n.store(0, std::memory_order_relaxed);
+      st->waitUs.store(0, std::memory_order_relaxed);    st->workUs.store(0, std::memory_order_relaxed);
+      st->waitMaxUs.store(0, std::memory_order_relaxed); st->workMaxUs.store(0, std::memory_order_relaxed);
+    }
+    pipeProcQ.peak.store(0, std::memory_order_relaxed);
+    pipeOutQ.peak.store(0, std::memory_order_relaxed);
+    pipeFreeMin.store(pipeFreeQ.depth(), std::memory_order_relaxed);
+  }
+  char buf[640];
+  BufWriter w(buf, sizeof(buf));
+  w.printf("{\"pool\":%lu,\"free\":%lu,\"freeMin\":%lu,\"noRec\":%lu,\"ingest\":{\"core\":%d,\"prio\":%d},\"stages\":[",
+           (unsigned long)PIPE_POOL, (unsigned long)pipeFreeQ.depth(), (unsigned long)pipeFreeMin.load(std::memory_order_relaxed),
+           (unsigned long)pipeNoRec.load(std::memory_order_relaxed), (int)PIPE_CORE_INGEST, (int)PIPE_PRIO_INGEST);
+  pipeStageJson(w, "proc", PIPE_CORE_PROC, PIPE_PRIO_PROC, pipeProcQ, pipeProcStat);
+  w.raw(",");
+  pipeStageJson(w, "out",  PIPE_CORE_OUT,  PIPE_PRIO_OUT,  pipeOutQ,  pipeOutStat);
+  w.raw("]}");
+  sendNoCache(req,200,"application/json",buf);
+}
+
+// Historial: GET /search?id=GGA&from=-60000&to=&limit=200
+//   id    3 letras = cualquier talker, 5 = exacto, vacío = todo
+//   from/to  ms de uptime; negativos = relativos a ahora; vacío = sin límite
+// Texto plano, una línea "<ms> RX|TX|BAD <sentencia>" por registro, en orden.
+void handleSearch(AsyncWebServerRequest* req){
+  if(!histSize){ sendNoCache(req,503,"text/plain","sin historial"); return; }
+  String id = req->hasArg("id") ? req->arg("id") : String();
+  id.toUpperCase();
+  if(id.length()!=0 && id.length()!=3 && id.length()!=5){ sendNoCache(req,400,"text/plain","id: 3 o 5 letras"); return; }
+  for(size_t i=0;i<id.length();i++){
+    char c = id[i];
+    if(!((c>='A' && c<='Z') || (c>='0' && c<='9'))){ sendNoCache(req,400,"text/plain","id invalido"); return; }
+  }
+  // Admisión recién con un pedido válido: los 400 no cuentan como carga
+  uint32_t t0 = webDataBegin(req);
+  if(!t0) return;
+  auto q = std::make_shared<HistSearch>();
+  memcpy(q->id, id.c_str(), id.length()); q->idLen = id.length();
+  uint32_t now = millis();
+  auto bound = [&](const char* name, uint32_t def)->uint32_t{
+    if(!req->hasArg(name) || req->arg(name).length()==0) return def;
+    long v = req->arg(name).toInt();
+    if(v >= 0) return (uint32_t)v;
+    return (uint32_t)-v > now ? 0 : now + v;
+  };
+  q->from  = bound("from", 0);
+  q->to    = bound("to", 0xFFFFFFFF);
+  q->limit = req->hasArg("limit") ? constrain(req->arg("limit").toInt(), 1, 2000) : 200;
+  q->cur   = histSeek(q->from);
+
+  // Cada trozo recorre a lo sumo HIST_SCAN_STEP registros en la misma tarea de
+  // AsyncTCP (también cuenta como ocupado). Sin nada para mandar todavía se
+  // pide otra vuelta (RESPONSE_TRY_AGAIN) en lugar de seguir recorriendo.
+  AsyncWebServerResponse* res = req->beginChunkedResponse("text/plain", [q](uint8_t* buf, size_t maxLen, size_t)->size_t{
+    uint32_t c0 = stampUs();
+    uint32_t budget = HIST_SCAN_STEP;
+    HistStep st = HIST_LINE;
+    size_t n = 0;
+    while(n < maxLen){
+      if(q->lineOff == q->lineLen && (st = histNextLine(*q, budget)) != HIST_LINE) break;
+      size_t k = min<size_t>(q->lineLen - q->lineOff, maxLen - n);
+      memcpy(buf + n, q->line + q->lineOff, k);
+      q->lineOff += k; n += k;
+    }
+    webDataEnd(c0);
+    if(!n && st == HIST_BUDGET) return RESPONSE_TRY_AGAIN;
+    return n;                                   // 0 = no hay más
+  });
+  noCache(res);
+  req->send(res);
+  webDataEnd(t0);                               // el arranque (seek)
+}
+
+// Descubrimiento Signal K (GET /signalk)
+void handleSignalK(AsyncWebServerRequest* req){
+  char b[256];
+  IPAddress ip = WiFi.softAPIP();
+  snprintf(b, sizeof(b),
+    "{\"endpoints\":{\"v1\":{\"version\":\"1.7.0\",\"signalk-ws\":\"ws://%u.%u.%u.%u/signalk/v1/stream\"}},"
+    "\"server\":{\"id\":\"nmealink\",\"version\":\"%s\"}}",
+    ip[0], ip[1], ip[2], ip[3], FW_VERSION);
+  sendNoCache(req,200,"application/json",b);
+}
+
+void handleSetFilters(AsyncWebServerRequest* req){ if(req->hasArg("mask")){ outCatMask[OUT_WEB]=(uint16_t)req->arg("mask").toInt() & FILTER_ALL; markConfigDirty(); } sendNoCache(req,200,"text/plain",String(outCatMask[OUT_WEB])); }
+
+static int outputByName(const String& n){
+  for(int o=0;o<OUT_COUNT;o++) if(n.equalsIgnoreCase(OUT_NAMES[o])) return o;
+  return -1;
+}
+// "udp,tcp" → OUT_BIT(OUT_UDP)|OUT_BIT(OUT_TCP)
+static uint8_t outputsFromList(const String& list){
+  uint8_t m=0; int start=0;
+  while(start <= (int)list.length()){
+    int comma = list.indexOf(',', start);
+    String tok = (comma<0) ? list.substring(start) : list.substring(start, comma);
+    tok.trim();
+    int o = outputByName(tok);
+    if(o>=0) m |= OUT_BIT(o);
+    if(comma<0) break;
+    start = comma+1;
+  }
+  return m;
+}
+
+// Máscaras por salida + reglas por ID
+void handleOutputs(AsyncWebServerRequest* req){
+  String json = "{\"masks\":{";
+  for(int o=0;o<OUT_COUNT;o++){
+    if(o) json += ",";
+    json += "\""; json += OUT_NAMES[o]; json += "\":" + String(outCatMask[o]);
+  }
+  json += "},\"cats\":[";
+  for(size_t i=0;i<sizeof(FILTER_CATS)/sizeof(FILTER_CATS[0]);i++){ if(i) json += ","; json += "\""; json += FILTER_CATS[i]; json += "\""; }
+  json += "],\"rules\":[";
+  bool first = true;
+  for(int i=0;i<ID_RULE_MAX;i++){
+    const IdRule& r = idRules[i];
+    if(!r.id[0]) continue;
+    if(!first) json += ",";
+    first = false;
+    json += "{\"id\":\""; json += r.id; json += "\",\"ms\":" + String(r.minMs) + ",\"drop\":[";
+    bool f2 = true;
+    for(int o=0;o<OUT_COUNT;o++) if(r.drop & OUT_BIT(o)){ if(!f2) json += ","; f2=false; json += "\""; json += OUT_NAMES[o]; json += "\""; }
+    json += "]}";
+  }
+  json += "],\"tcpClients\":" + String(tcpClientCount) + ",\"tcpDrops\":" + String(tcpDrops.load(std::memory_order_relaxed)) + "}";
+  sendNoCache(req,200,"application/json",json);
+}
+
+// /setoutput?out=udp&mask=511
+void handleSetOutput(AsyncWebServerRequest* req){
+  int o = req->hasArg("out") ? outputByName(req->arg("out")) : -1;
+  if(o<0 || !req->hasArg("mask")){ sendNoCache(req,400,"text/plain","Error"); return; }
+  outCatMask[o] = (uint16_t)req->arg("mask").toInt() & FILTER_ALL;
+  markConfigDirty();
+  sendNoCache(req,200,"text/plain",String(outCatMask[o]));
+}
+
+// /idrule?id=GSV&ms=1000&drop=udp,tcp   (ms=0 y sin drop → borra la regla)
+void handleIdRule(AsyncWebServerRequest* req){
+  String id = req->hasArg("id") ? req->arg("id") : "";
+  id.trim(); id.toUpperCase();
+  if(id.length()!=3 && id.length()!=5){ sendNoCache(req,400,"text/plain","Error"); return; }
+  uint16_t ms   = req->hasArg("ms") ? (uint16_t)constrain(req->arg("ms").toInt(), 0, 60000) : 0;
+  uint8_t  drop = req->hasArg("drop") ? outputsFromList(req->arg("drop")) : 0;
+
+  xSemaphoreTake(slotWriteMutex,portMAX_DELAY);
+  int slot=-1, freeSlot=-1;
+  for(int i=0;i<ID_RULE_MAX;i++){
+    if(strcmp(idRules[i].id, id.c_str())==0){ slot=i; break; }
+    if(!idRules[i].id[0] && freeSlot<0) freeSlot=i;
+  }
+  if(slot<0) slot=freeSlot;
+  bool ok = (slot>=0) || (!ms && !drop);
+  if(slot>=0){
+    idRulesGen.fetch_add(1, std::memory_order_acq_rel);    // impar: escribiendo
+    IdRule& r = idRules[slot];
+    if(!ms && !drop) memset(&r, 0, sizeof(r));
+    else { SET_STR(r.id, id.c_str()); r.drop=drop; r.minMs=ms; }
+    idRulesGen.fetch_add(1, std::memory_order_acq_rel);    // par: publicado
+  }
+  xSemaphoreGive(slotWriteMutex);
+  if(!ok){ sendNoCache(req,507,"text/plain","Full"); return; }
+  markConfigDirty();
+  sendNoCache(req,200,"text/plain","OK");
+}
+void handleSetConfig(AsyncWebServerRequest* req){
+  String src = req->hasArg("iecsrc") ? req->arg("iecsrc") : String();
+  src.toUpperCase();
+  if(src.length() && !iecSrcValid(src.c_str())){ sendNoCache(req,400,"text/plain","Bad iecsrc (XX0000)"); return; }
+  if(req->hasArg("autoresume")) cfgAutoResume = (req->arg("autoresume")=="1");
+  if(req->hasArg("skipsplash")) cfgSkipSplash = (req->arg("skipsplash")=="1");
+  if(req->hasArg("dedup"))      cfgDedup      = (req->arg("dedup")=="1");
+  if(req->hasArg("skws"))       cfgSkWs       = (req->arg("skws")=="1");
+  if(req->hasArg("skudp"))      cfgSkUdp      = (req->arg("skudp")=="1");
+  if(req->hasArg("n2k"))        cfgN2k        = (req->arg("n2k")=="1");
+  if(req->hasArg("iec450"))     cfgIec450     = (req->arg("iec450")=="1");
+  if(req->hasArg("rxtag"))      cfgRxTag      = (req->arg("rxtag")=="1");
+  if(src.length())             SET_STR(iecSrc, src.c_str());
+  if(req->hasArg("dedupwin"))   dedupWindowMs    = (uint16_t)constrain(req->arg("dedupwin").toInt(), 100, 60000);
+  if(req->hasArg("dedupka"))    dedupKeepAliveMs = (uint16_t)constrain(req->arg("dedupka").toInt(), 500, 60000);
+  markConfigDirty();
+  sendNoCache(req,200,"text/plain","OK");
 }
 
 // ===================== UI (OLED) =====================
@@ -881,16 +2668,175 @@ void drawSplash(uint32_t now){
   u8g2.sendBuffer();
 }
 
-inline bool recentTs(uint32_t ts, uint32_t windowMs){
-  if (ts==0) return false;
-  return (millis() - ts) <= windowMs;
+// ---------- Retained mode: view-model + envío sólo de tiles cambiados ----------
+// Todo lo que se ve en pantalla sale de OledView. Si no cambió, no se dibuja
+// ni se toca el SPI; si cambió, se redibuja en RAM y sólo se envían los tiles
+// (8x8 px) distintos al último frame enviado.
+enum OledPage : uint8_t { PAGE_STATUS=0, PAGE_NAV, PAGE_HEALTH, PAGE_COUNT };
+
+// PAGE_NAV: valores ya redondeados a lo que se muestra (no redibujar por decimales invisibles)
+const uint32_t NAV_STALE_MS = 10000;          // dato más viejo → "--"
+enum : uint16_t {
+  NAV_POS=1<<0, NAV_SOG=1<<1, NAV_COG=1<<2, NAV_HDG=1<<3, NAV_DPT=1<<4,
+  NAV_AW=1<<5, NAV_TW=1<<6, NAV_H2O=1<<7, NAV_AIR=1<<8, NAV_FIX=1<<9,
+};
+struct NavView {
+  uint16_t valid;                            // NAV_* con dato fresco
+  uint8_t  fix, sats;
+  int32_t  lat5, lon5;                       // grados ×1e5
+  int16_t  sog10, cog, hdg10, dpt10;
+  int16_t  awa, aws10, twa, tws10;
+  int16_t  h2o10, air10, hdop10;
+  uint8_t  dptRef, _pad;                     // DepthRef de dpt10
+};
+struct OledView {
+  uint8_t  ota;
+  uint8_t  mode;       // AppMode
+  uint8_t  run;
+  uint8_t  page;       // OledPage
+  uint32_t baud;
+  uint16_t active;     // bit i = sensors[i] visible
+  uint16_t stale;      // bit i = sensors[i] se cortó (alarma)
+  // PAGE_HEALTH (en cero en la otra página → no provocan redibujo)
+  uint16_t rxps, outps;
+  uint16_t csPermille; // errores de checksum / líneas, últimos STAT_HIST s
+  uint8_t  stations;
+  uint8_t  tcpClients;
+  uint8_t  uartPct;
+  uint8_t  otaPct;     // progreso del upload (con v.ota)
+  uint16_t heapKB;
+  uint32_t seq;        // cambia con cada muestra → avanza la sparkline
+  NavView  nav;        // PAGE_NAV
+};
+static OledView oledLast;
+static bool     oledLastValid = false;
+static uint8_t  oledShadow[1024];          // copia de lo que tiene el panel (128x64 / 8)
+static bool     oledShadowValid = false;
+volatile uint32_t oledFrames    = 0;       // frames con cambios
+volatile uint32_t oledTilesSent = 0;
+
+void oledInvalidate(){ oledShadowValid = false; oledLastValid = false; }
+
+// ---------- Páginas: timer + botón BOOT ----------
+const uint32_t OLED_PAGE_MS   = 6000;     // rotación automática
+volatile uint8_t oledPage     = PAGE_STATUS;
+static uint32_t  pageSinceMs  = 0;
+static bool      btnWasDown   = false;
+
+void pollPage(){
+  uint32_t now = millis();
+  bool down = (digitalRead(BTN_PIN) == LOW);
+  if(down && !btnWasDown){                               // flanco: siguiente página
+    oledPage = (oledPage + 1) % PAGE_COUNT;
+    pageSinceMs = now;
+  }
+  btnWasDown = down;
+  if(now - pageSinceMs >= OLED_PAGE_MS){
+    oledPage = (oledPage + 1) % PAGE_COUNT;
+    pageSinceMs = now;
+  }
+}
+
+// ---------- Muestreo de métricas (1 Hz, sólo TaskUI) ----------
+void statsSample(){
+  static uint32_t lastMs = 0, lastRx = 0, lastOut = 0, lastCs = 0;
+  uint32_t now = millis();
+  if(lastMs && now - lastMs < 1000) return;
+  uint32_t rx  = statRxLines.load(std::memory_order_relaxed);
+  uint32_t out = statOutLines.load(std::memory_order_relaxed);
+  uint32_t cs  = statCsBad.load(std::memory_order_relaxed);
+  if(lastMs){
+    statRxHist [statHead] = (uint16_t)min<uint32_t>(rx  - lastRx,  0xFFFF);
+    statOutHist[statHead] = (uint16_t)min<uint32_t>(out - lastOut, 0xFFFF);
+    statCsHist [statHead] = (uint16_t)min<uint32_t>(cs  - lastCs,  0xFFFF);
+    statHead = (statHead + 1) % STAT_HIST;
+    statSeq++;
+  }
+  statUartPct = (uint8_t)min<uint32_t>(uartPeak*100u/UART_RX_BUF, 100);
+  uartPeak    = 0;                         // pico por muestra
+  statHeapKB  = ESP.getFreeHeap() / 1024;
+  lastMs = now; lastRx = rx; lastOut = out; lastCs = cs;
+}
+static inline uint16_t statLast(const uint16_t* h){ return h[(statHead + STAT_HIST - 1) % STAT_HIST]; }
+
+// Envía por fila de tiles el rango [primer..último] tile modificado
+void oledFlush(){
+  uint8_t* buf = u8g2.getBufferPtr();
+  const int tw = u8g2.getBufferTileWidth();
+  const int th = u8g2.getBufferTileHeight();
+  for(int ty=0; ty<th; ty++){
+    int x0=-1, x1=-1;
+    for(int tx=0; tx<tw; tx++){
+      const int off = (ty*tw + tx)*8;
+      if(oledShadowValid && memcmp(buf+off, oledShadow+off, 8)==0) continue;
+      memcpy(oledShadow+off, buf+off, 8);
+      if(x0<0) x0=tx;
+      x1=tx;
+    }
+    if(x0>=0){
+      u8g2.updateDisplayArea(x0, ty, x1-x0+1, 1);
+      oledTilesSent += x1-x0+1;
+    }
+  }
+  oledShadowValid = true;
+}
+
+OledView buildView(){
+  OledView v; memset(&v, 0, sizeof(v));
+  v.ota  = otaActive;
+  if(v.ota && otaTotal) v.otaPct = (uint8_t)min<uint32_t>((uint64_t)otaReceived*100/otaTotal, 100);
+  v.mode = (uint8_t)appMode;
+  v.run  = (appMode==MODE_MONITOR) ? monitorRunning : generatorRunning;
+  v.baud = currentBaud;
+  v.page = oledPage;
+  if(v.page == PAGE_NAV){
+    const VesselState s = vesselSnapshot();
+    const uint32_t now = millis();
+    auto fresh = [&](uint32_t t){ return t && (now - t) <= NAV_STALE_MS; };
+    NavView& n = v.nav;
+    if(fresh(s.tPos))      { n.valid|=NAV_POS; n.lat5=s.latE7/100; n.lon5=s.lonE7/100; }
+    if(fresh(s.tSog))      { n.valid|=NAV_SOG; n.sog10=s.sogKn100/10; }
+    if(fresh(s.tCog))      { n.valid|=NAV_COG; n.cog=(s.cogDeg100+50)/100 % 360; }
+    if(fresh(s.tHdgTrue))  { n.valid|=NAV_HDG; n.hdg10=s.hdgTrueDeg100/10; }
+    if(fresh(s.tDepth))    { n.valid|=NAV_DPT; n.dpt10=depthShownM100(s)/10; n.dptRef=depthRef(s); }
+    if(fresh(s.tAppWind))  { n.valid|=NAV_AW;  n.awa=(s.awaDeg100+50)/100; n.aws10=s.awsKn100/10; }
+    if(fresh(s.tTrueWind)) { n.valid|=NAV_TW;  n.twa=(s.twaDeg100+50)/100; n.tws10=s.twsKn100/10; }
+    if(fresh(s.tWaterTemp)){ n.valid|=NAV_H2O; n.h2o10=s.waterTempC100/10; }
+    if(fresh(s.tAirTemp))  { n.valid|=NAV_AIR; n.air10=s.airTempC100/10; }
+    if(fresh(s.tFix))      { n.valid|=NAV_FIX; n.fix=s.fixQuality; n.sats=s.sats; n.hdop10=s.hdop100/10; }
+    return v;
+  }
+  if(v.page == PAGE_HEALTH){
+    uint32_t rxSum = 0, csSum = 0;
+    for(int i=0;i<STAT_HIST;i++){ rxSum += statRxHist[i]; csSum += statCsHist[i]; }
+    v.rxps       = statLast(statRxHist);
+    v.outps      = statLast(statOutHist);
+    v.csPermille = rxSum ? (uint16_t)min<uint32_t>(csSum*1000u/rxSum, 1000) : 0;
+    v.stations   = WiFi.softAPgetStationNum();
+    v.tcpClients = tcpClientCount;
+    v.uartPct    = statUartPct;
+    v.heapKB     = statHeapKB;
+    v.seq        = statSeq;
+    return v;
+  }
+  uint32_t now = millis();
+  for(int i=0;i<SENSOR_COUNT;i++){
+    if(appMode==MODE_GENERATOR){
+      if(rateState(sensors[i].gen, now)==ST_ACTIVE) v.active |= (1u<<i);
+      continue;
+    }
+    StreamState st = rateState(sensors[i].rx, now);
+    if(st==ST_ACTIVE) v.active |= (1u<<i);
+    else if(st==ST_STALE && monitorRunning) v.stale |= (1u<<i);   // en pausa no es una falla
+  }
+  return v;
 }
 
 // Header compacto
-void drawHeader(){
-  const char* modeCode = (appMode==MODE_GENERATOR) ? "GEN" : "MON";
+void drawHeader(const OledView& v){
+  const char* modeCode = (v.mode==MODE_GENERATOR) ? "GEN" : "MON";
   char left[24];  snprintf(left,  sizeof(left),  "Mode: %s", modeCode);
-  char right[24]; snprintf(right, sizeof(right), "Baud: %d", currentBaud);
+  char right[24]; snprintf(right, sizeof(right), "Baud: %lu", (unsigned long)v.baud);
 
   const int minSep = 6;
 
@@ -906,26 +2852,102 @@ void drawHeader(){
   }
 
   // Ultra compacto
-  const char* leftS  = (appMode==MODE_GENERATOR) ? "M: GEN" : "M: MON";
-  char rightS[16]; snprintf(rightS, sizeof(rightS), "B: %d", currentBaud);
+  const char* leftS  = (v.mode==MODE_GENERATOR) ? "M: GEN" : "M: MON";
+  char rightS[16]; snprintf(rightS, sizeof(rightS), "B: %lu", (unsigned long)v.baud);
   u8g2.drawStr(0, 9, leftS);
   drawRight(rightS, 9, FONT_HDR_SMALL);
   u8g2.drawHLine(0, 12, 128);
 }
 
-void drawStatus(){
+// Sparkline de sentencias/s entrantes (escala al máximo de la ventana)
+void drawSparkline(int y0, int h){
+  uint16_t peak = 1;
+  for(int i=0;i<STAT_HIST;i++) if(statRxHist[i] > peak) peak = statRxHist[i];
+  int px=-1, py=-1;
+  for(int i=0;i<STAT_HIST;i++){
+    uint16_t val = statRxHist[(statHead + i) % STAT_HIST];   // más viejo → más nuevo
+    int x = i*2;
+    int y = y0 + h - 1 - (int)((uint32_t)val*(h-1)/peak);
+    if(px>=0) u8g2.drawLine(px, py, x, y); else u8g2.drawPixel(x, y);
+    px = x; py = y;
+  }
+  char lbl[12]; snprintf(lbl, sizeof(lbl), "%u", (unsigned)peak);
+  drawRight(lbl, y0 + 7, FONT_LIST);
+}
+
+void renderHealth(const OledView& v){
+  char l[24], r[24];
+  u8g2.setFont(FONT_LIST);
+  snprintf(l, sizeof(l), "IN %u/s",  (unsigned)v.rxps);
+  snprintf(r, sizeof(r), "OUT %u/s", (unsigned)v.outps);
+  u8g2.drawStr(0, 8, l); drawRight(r, 8, FONT_LIST);
+
+  snprintf(l, sizeof(l), "CS %u.%u%%", (unsigned)(v.csPermille/10), (unsigned)(v.csPermille%10));
+  snprintf(r, sizeof(r), "STA %u TCP %u", (unsigned)v.stations, (unsigned)v.tcpClients);
+  u8g2.drawStr(0, 17, l); drawRight(r, 17, FONT_LIST);
+
+  snprintf(l, sizeof(l), "UART %u%%", (unsigned)v.uartPct);
+  snprintf(r, sizeof(r), "HEAP %uk",  (unsigned)v.heapKB);
+  u8g2.drawStr(0, 26, l); drawRight(r, 26, FONT_LIST);
+
+  u8g2.drawHLine(0, 29, 128);
+  drawSparkline(32, 32);
+}
+
+// "-12.3" a partir de ×10
+static void fmt10(char* b, size_t n, const char* lbl, int32_t v10, const char* unit){
+  snprintf(b, n, "%s %s%ld.%ld%s", lbl, v10<0?"-":"", (long)(labs(v10)/10), (long)(labs(v10)%10), unit);
+}
+void renderNav(const OledView& v){
+  const NavView& n = v.nav;
+  char l[28], r[24];
+  u8g2.setFont(FONT_LIST);
+  auto row = [&](int y){ u8g2.drawStr(0, y, l); drawRight(r, y, FONT_LIST); };
+
+  if(n.valid & NAV_POS)
+    snprintf(l, sizeof(l), "POS %s%ld.%05ld %s%ld.%05ld",
+             n.lat5<0?"-":"", (long)(labs(n.lat5)/100000), (long)(labs(n.lat5)%100000),
+             n.lon5<0?"-":"", (long)(labs(n.lon5)/100000), (long)(labs(n.lon5)%100000));
+  else snprintf(l, sizeof(l), "POS --");
+  u8g2.drawStr(0, 8, l);
+
+  if(n.valid & NAV_SOG) fmt10(l, sizeof(l), "SOG", n.sog10, "kn"); else snprintf(l, sizeof(l), "SOG --");
+  if(n.valid & NAV_COG) snprintf(r, sizeof(r), "COG %03d", n.cog);  else snprintf(r, sizeof(r), "COG --");
+  row(17);
+  if(n.valid & NAV_HDG) fmt10(l, sizeof(l), "HDG", n.hdg10, "T");   else snprintf(l, sizeof(l), "HDG --");
+  if(n.valid & NAV_DPT) fmt10(r, sizeof(r), DEPTH_LABEL[n.dptRef], n.dpt10, "m");   else snprintf(r, sizeof(r), "DPT --");
+  row(26);
+  if(n.valid & NAV_AW){ snprintf(l, sizeof(l), "AWA %03d", n.awa); fmt10(r, sizeof(r), "AWS", n.aws10, "kn"); }
+  else { snprintf(l, sizeof(l), "AWA --"); snprintf(r, sizeof(r), "AWS --"); }
+  row(35);
+  if(n.valid & NAV_TW){ snprintf(l, sizeof(l), "TWA %03d", n.twa); fmt10(r, sizeof(r), "TWS", n.tws10, "kn"); }
+  else { snprintf(l, sizeof(l), "TWA --"); snprintf(r, sizeof(r), "TWS --"); }
+  row(44);
+  if(n.valid & NAV_H2O) fmt10(l, sizeof(l), "H2O", n.h2o10, "C");   else snprintf(l, sizeof(l), "H2O --");
+  if(n.valid & NAV_AIR) fmt10(r, sizeof(r), "AIR", n.air10, "C");   else snprintf(r, sizeof(r), "AIR --");
+  row(53);
+  if(n.valid & NAV_FIX){ snprintf(l, sizeof(l), "FIX %u SAT %u", n.fix, n.sats); fmt10(r, sizeof(r), "HDOP", n.hdop10, ""); }
+  else { snprintf(l, sizeof(l), "FIX --"); r[0]=0; }
+  row(62);
+}
+
+void renderStatus(const OledView& v){
   u8g2.clearBuffer();
 
-  if(otaActive){
+  if(v.ota){
     drawCentered("OTA UPDATE", 24, FONT_TITLE);
     drawCentered("DO NOT POWER OFF", 40, FONT_SUB);
+    char b[24]; snprintf(b, sizeof(b), "%u%%  NMEA ON", v.otaPct);   // el tráfico sigue hasta el reinicio
+    drawCentered(b, 56, FONT_SUB);
     // (SIN versión aquí)
-    u8g2.sendBuffer();
     return;
   }
 
+  if(v.page == PAGE_HEALTH){ renderHealth(v); return; }
+  if(v.page == PAGE_NAV){    renderNav(v);    return; }
+
   // Header
-  drawHeader();
+  drawHeader(v);
 
   // Zona de sensores
   const int topY    = 18;
@@ -933,17 +2955,12 @@ void drawStatus(){
   const int colAX   = 2;
   const int colBX   = 66;
 
-  const char* active[12];
+  // Los flujos cortados quedan en la lista marcados con '!'
+  char active[12][14];
   int nActive = 0;
-
-  if(appMode==MODE_GENERATOR){
-    for(int i=0;i<SENSOR_COUNT;i++)
-      if(recentTs(sensors[i].lastGenMs, OLED_IDLE_WINDOW_MS))
-        active[nActive++] = sensors[i].name;
-  } else {
-    for(int i=0;i<SENSOR_COUNT;i++)
-      if(recentTs(sensors[i].lastSeenMs, OLED_IDLE_WINDOW_MS))
-        active[nActive++] = sensors[i].name;
+  for(int i=0;i<SENSOR_COUNT;i++){
+    if(v.active & (1u<<i))     snprintf(active[nActive++], sizeof(active[0]), "%s", sensors[i].name);
+    else if(v.stale & (1u<<i)) snprintf(active[nActive++], sizeof(active[0]), "%s !", sensors[i].name);
   }
 
   u8g2.setFont(FONT_LIST);
@@ -965,128 +2982,382 @@ void drawStatus(){
   }
 
   // Estado RUN/PAUSE abajo a la derecha
-  const bool isRun = (appMode==MODE_MONITOR) ? monitorRunning : generatorRunning;
-  drawRight(isRun ? "RUN" : "PAUSE", 63, FONT_LIST);
-
+  drawRight(v.run ? "RUN" : "PAUSE", 63, FONT_LIST);
   // (SIN versión aquí)
-  u8g2.sendBuffer();
+}
+
+void drawStatus(){
+  OledView v = buildView();
+  if(oledLastValid && memcmp(&v, &oledLast, sizeof(v))==0) return;   // idle: sin dibujo ni SPI
+  renderStatus(v);
+  oledFlush();
+  oledLast = v; oledLastValid = true;
+  oledFrames++;
 }
 
 // ===================== Tasks =====================
 void TaskNet(void*){
   for(;;){
-    dnsServer.processNextRequest();
-    server.handleClient();
+    dnsServer.processNextRequest();   // HTTP lo atiende AsyncTCP (event-driven)
+    static uint32_t lastWsCleanup = 0;
+    if(millis() - lastWsCleanup > 1000){ skWs.cleanupClients(4); lastWsCleanup = millis(); }
+    if(rebootAtMs && (int32_t)(millis()-rebootAtMs) >= 0) ESP.restart();
     vTaskDelay(1);
   }
 }
 
-void TaskNMEA(void*){
-  for(;;){
-    if(appMode==MODE_MONITOR && monitorRunning){
-      xSemaphoreTake(serialMutex,portMAX_DELAY);
+// ---------- Pipeline ----------
+// TaskNMEA: registro libre para una línea nueva (nullptr = pool agotado, se pierde la línea)
+static PipeRec* pipeAlloc(){
+  PipeRec* r;
+  if(!pipeFreeQ.pop(r)){ pipeNoRec.fetch_add(1, std::memory_order_relaxed); return nullptr; }
+  uint32_t f = pipeFreeQ.depth();
+  if(f < pipeFreeMin.load(std::memory_order_relaxed)) pipeFreeMin.store(f, std::memory_order_relaxed);
+  r->rxUs = 0; r->pgn = 0; r->len = 0; r->n2kSrc = 0; r->cat = -1; r->outs = 0;
+  return r;
+}
+// TaskNMEA → TaskProc (la cola tiene lugar para todo el pool: nunca falla)
+static void pipeSubmit(PipeRec* r){
+  r->queuedUs = stampUs();
+  pipeProcQ.push(r);
+  xTaskNotifyGive(pipeProcTask);
+}
 
-      // Timeout de línea rota
-      if(currentLine.length()>0 && (millis() - lineStartMs) > LINE_TIMEOUT_MS){
-        currentLine = "";
-        lineStartMs = 0;
+// Camino del monitor para una línea (UART o N2K convertido). Sólo desde TaskProc.
+// Deja en el registro la sentencia efectiva (sin tag block), su categoría y las salidas de red.
+static void procRx(PipeRec& r){
+  char srcMeta[32];
+  if(r.kind==PIPE_N2K) snprintf(srcMeta, sizeof(srcMeta), "N2K %lu src=%u", (unsigned long)r.pgn, (unsigned)r.n2kSrc);
+  const bool hasSrc = (r.kind==PIPE_N2K);
+
+  // Parseo TagBlock / UdPbC
+  String raw(r.text), sentence, meta;
+  bool hadTag=false, hadUdPbC=false;
+  bool ok = parseNMEALine(raw, sentence, meta, hadTag, hadUdPbC);
+
+  String effective = ok ? sentence : raw;   // si no se pudo parsear, seguimos con la cruda
+  bool valid = processNMEA(effective);
+  statRxLines.fetch_add(1, std::memory_order_relaxed);
+  bool csOk = valid && nmeaChecksumOk(effective);
+  if(valid && !csOk) statCsBad.fetch_add(1, std::memory_order_relaxed);
+
+  ledEvent(valid ? LED_EV_RX_OK : LED_EV_RX_BAD);
+
+  String type=detectSentenceType(effective);
+  uint32_t now = millis();
+  int cat  = sensorIndexByName(type);
+  int si   = valid ? stampSeen(effective, cat, now) : -1;
+  histAppend(effective, now, valid ? 0 : HIST_F_BAD);
+  if(csOk) skDirty.fetch_or(parseVessel(effective, now), std::memory_order_relaxed);
+  bool dup = (si>=0) && cfgDedup && isDuplicate(streams[si], effective, now);
+  uint8_t outs = dup ? 0 : outputsFor(cat, si, now);
+  if(!valid) outs &= OUT_BIT(OUT_WEB);       // las inválidas sólo se ven en la consola
+
+  if(outs & OUT_BIT(OUT_WEB)){
+    String formatted="["+type+"] "+effective;
+    if(hasSrc){
+      if(meta.length()) meta += " ";
+      meta += srcMeta;
+    }
+    if(hadTag || hadUdPbC || hasSrc){
+      if(meta.length()==0){
+        meta = String(hadUdPbC ? "UdPbC" : "");
       }
+      formatted += "  ⟨" + meta + "⟩";
+    }
 
-      while(NMEA_Serial.available()){
-        char c=(char)NMEA_Serial.read();
-        if(lineStartMs==0) lineStartMs = millis();
+    xSemaphoreTake(nmeaBufMutex,portMAX_DELAY);
+    nmeaConsole.push(formatted);
+    xSemaphoreGive(nmeaBufMutex);
+  }
 
-        if(c=='\n' || c=='\r'){
-          if(currentLine.length()==0) continue;
+  if(ok){                                    // sin el tag block: nunca más larga que la cruda
+    r.len = min<size_t>(effective.length(), MAX_LINE_LEN);
+    memcpy(r.text, effective.c_str(), r.len);
+    r.text[r.len] = 0;
+  }
+  r.cat  = cat;
+  r.outs = outs & (OUT_BIT(OUT_UDP)|OUT_BIT(OUT_TCP));
+}
 
-          xSemaphoreGive(serialMutex);
+// Lo que ya salió por el UART del generador: ritmo, historial, consola y red
+static void procGen(PipeRec& r){
+  uint32_t now = millis();
+  if(r.cat >= 0) rateStamp(sensors[r.cat].gen, now);
+  String out(r.text);
+  histAppend(out, now, HIST_F_TX);
+  pushGen(out);
+  r.outs = OUT_BIT(OUT_UDP)|OUT_BIT(OUT_TCP);
+}
 
-          String raw=currentLine;
-          currentLine="";
-          lineStartMs=0;
-          raw.trim();
+// TaskOut: todo lo que toca lwIP
+static void outRecord(const PipeRec& r){
+  if(r.outs & OUT_BIT(OUT_UDP)) sendUDP(r.text, r.len, r.cat, r.rxUs);
+  if(r.outs & OUT_BIT(OUT_TCP)) sendTCP(r.text, r.len, r.rxUs);
+  if(r.outs) statOutLines.fetch_add(1, std::memory_order_relaxed);
+}
 
-          if(raw.length()==0){ xSemaphoreTake(serialMutex,portMAX_DELAY); continue; }
+// ---------- NMEA 2000 ----------
+static bool twaiUp(){
+  twai_general_config_t g = TWAI_GENERAL_CONFIG_DEFAULT((gpio_num_t)CAN_TX_PIN, (gpio_num_t)CAN_RX_PIN, TWAI_MODE_LISTEN_ONLY);
+  g.rx_queue_len = 64;
+  twai_timing_config_t t = TWAI_TIMING_CONFIG_250KBITS();   // NMEA 2000
+  twai_filter_config_t f = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+  if(twai_driver_install(&g, &t, &f) != ESP_OK) return false;
+  if(twai_start() != ESP_OK){ twai_driver_uninstall(); return false; }
+  return true;
+}
+static void twaiDown(){
+  twai_stop();
+  twai_driver_uninstall();
+}
 
-          // Parseo TagBlock / UdPbC
-          String sentence, meta;
-          bool hadTag=false, hadUdPbC=false;
-          bool ok = parseNMEALine(raw, sentence, meta, hadTag, hadUdPbC);
+// Ingesta CAN: reensamblado + conversión en lib/N2K, salida a n2kQueue
+void TaskCAN(void*){
+  for(;;){
+    if(cfgN2k != n2kBusUp){
+      if(cfgN2k){
+        n2kBusUp = twaiUp();
+        if(!n2kBusUp){ vTaskDelay(5000); continue; }        // sin driver: reintentar más tarde
+      } else {
+        twaiDown();
+        n2kBusUp = false;
+      }
+    }
+    if(!n2kBusUp){ vTaskDelay(200); continue; }
+
+    twai_message_t m;
+    if(twai_receive(&m, pdMS_TO_TICKS(100)) != ESP_OK) continue;
+    if(!m.extd || m.rtr) continue;                          // N2K usa sólo IDs de 29 bits
+    N2kFrame f;
+    f.id  = m.identifier;
+    f.len = m.data_length_code > 8 ? 8 : m.data_length_code;
+    memcpy(f.data, m.data, 8);
+    n2k.onFrame(f, millis());
+  }
+}
 
-          String effective = ok ? sentence : raw;   // si no se pudo parsear, seguimos con la cruda
-          bool valid = processNMEA(effective);
+// Destellos del LED: una ventana → a lo sumo un color (ver sección LED)
+void TaskLED(void*){
+  uint32_t seen[LED_EV_COUNT] = {0};
+  for(;;){
+    int dom = -1; uint32_t best = 0;
+    for(int e=0;e<LED_EV_COUNT;e++){
+      uint32_t c = ledEvents[e].load(std::memory_order_relaxed);
+      if(c - seen[e] > best){ best = c - seen[e]; dom = e; }
+      seen[e] = c;
+    }
+    if(dom < 0){ vTaskDelay(pdMS_TO_TICKS(LED_WINDOW_MS)); continue; }
+    ledShow(LED_COLORS[dom]);
+    vTaskDelay(pdMS_TO_TICKS(LED_ON_MS));
+    ledShow(0);
+    vTaskDelay(pdMS_TO_TICKS(LED_WINDOW_MS - LED_ON_MS));
+  }
+}
 
-          flashLed(valid?pixels.Color(0,255,0):pixels.Color(255,0,0));
+// Escritura OTA a flash, a baja prioridad (ver sección OTA)
+void TaskOTA(void*){
+  for(;;){
+    OtaMsg m;
+    if(xQueueReceive(otaQueue, &m, pdMS_TO_TICKS(OTA_IDLE_TIMEOUT_MS)) != pdTRUE){
+      if(otaPhase==OTA_RECEIVING) otaFail("timeout");
+      otaAck(true);
+      continue;
+    }
+    switch(m.kind){
+      case OTA_MSG_BEGIN:
+        otaTailLen = 0;
+        mbedtls_sha256_init(&otaSha);
+        mbedtls_sha256_starts(&otaSha, 0);
+        if(!Update.begin(UPDATE_SIZE_UNKNOWN)) otaFail(Update.errorString());
+        break;
+      case OTA_MSG_DATA:
+        if(otaPhase==OTA_RECEIVING) otaWrite(otaPool[m.slot], m.len);
+        xQueueSend(otaFree, &m.slot, 0);
+        otaAck(otaPhase != OTA_RECEIVING);     // falló: que el resto entre y se descarte
+        break;
+      case OTA_MSG_END:
+        if(otaPhase==OTA_RECEIVING) otaFinish();
+        otaAck(true);
+        break;
+      case OTA_MSG_ABORT:
+        if(otaPhase==OTA_RECEIVING) otaFail("no buffer");
+        otaAck(true);
+        break;
+    }
+  }
+}
 
-          String type=detectSentenceType(effective);
-          if(valid && type!="OTROS"){ stampSeen(type); }
+// Ingesta: UART (o generador) + cola N2K → registros del pool → TaskProc.
+// No parsea ni toca la red: sólo arma líneas y las estampa.
+void TaskNMEA(void*){
+  PipeRec* cur = nullptr;                  // línea en armado
+  bool     skip = false;                   // pool agotado: se descarta hasta el fin de línea
+  uint32_t lineStartMs = 0;                // timeout para líneas rotas
+  for(;;){
+    // Cambio de baud pedido por la web: entre lecturas, descartando la línea a medias
+    int nb = baudRequest.load(std::memory_order_relaxed);
+    if(nb){
+      if(nb != currentBaud){
+        startSerial(nb);
+        if(cur) cur->len = 0;
+        skip = false;
+        lineRxUs = 0;
+      }
+      baudRequest.compare_exchange_strong(nb, 0);   // recién ahora: la persistencia nunca ve el baud viejo
+    }
+    if(appMode==MODE_MONITOR && monitorRunning){
+      xSemaphoreTake(serialMutex,portMAX_DELAY);
 
-          String formatted="["+type+"] "+effective;
-          if(hadTag || hadUdPbC){
-            if(meta.length()==0){
-              meta = String(hadUdPbC ? "UdPbC" : "");
-            }
-            formatted += "  ⟨" + meta + "⟩";
-          }
+      // Timeout de línea rota
+      if(((cur && cur->len) || skip) && (millis() - lineStartMs) > LINE_TIMEOUT_MS){
+        if(cur) cur->len = 0;
+        skip = false;
+        lineRxUs = 0;
+      }
 
-          xSemaphoreTake(nmeaBufMutex,portMAX_DELAY);
-          bufferIndex=(bufferIndex+1)%BUFFER_LINES;
-          nmeaBuffer[bufferIndex]=formatted;
-          xSemaphoreGive(nmeaBufMutex);
+      int pending = NMEA_Serial.available();
+      if(pending > uartPeak) uartPeak = pending;
+      const uint32_t byteUs = 10000000UL / currentBaud;   // 10 bits por byte (8N1)
 
-          if(valid) sendUDP(effective);
+      while(NMEA_Serial.available()){
+        char c=(char)NMEA_Serial.read();
 
-          xSemaphoreTake(serialMutex,portMAX_DELAY);
+        if(c=='\n' || c=='\r'){
+          if(skip){ skip = false; lineRxUs = 0; continue; }
+          if(!cur || cur->len==0) continue;
+          // trim: sólo pueden sobrar espacios (el resto de los de control no entra)
+          uint16_t a = 0, b = cur->len;
+          while(a < b && cur->text[a]==' ') a++;
+          while(b > a && cur->text[b-1]==' ') b--;
+          if(a) memmove(cur->text, cur->text + a, b - a);
+          cur->len = b - a;
+          if(cur->len==0){ lineRxUs = 0; continue; }
+          cur->text[cur->len] = 0;
+          cur->kind = PIPE_UART;
+          cur->rxUs = lineRxUs;
+          pipeSubmit(cur);
+          cur = nullptr;
+          lineRxUs = 0;
         }
         else if(c>=32 && c<=126){
-          if(currentLine.length() < MAX_LINE_LEN){
-            currentLine+=c;
+          if(skip) continue;
+          if(!cur && !(cur = pipeAlloc())){ skip = true; lineStartMs = millis(); continue; }
+          if(cur->len==0) lineStartMs = millis();
+          // Los bytes que ya esperan detrás de éste llegaron después: se descuentan
+          if((c=='$' || c=='!') && !lineRxUs) lineRxUs = (stampUs() - (uint32_t)NMEA_Serial.available()*byteUs) | 1;
+          if(cur->len < MAX_LINE_LEN){
+            cur->text[cur->len++] = c;
           } else {
-            currentLine="";
-            lineStartMs=0;
+            cur->len = 0;
+            lineRxUs = 0;
           }
         }
       }
       xSemaphoreGive(serialMutex);
+
+      // Sentencias convertidas desde NMEA 2000
+      N2kLine l;
+      while(xQueueReceive(n2kQueue, &l, 0) == pdTRUE){
+        PipeRec* r = pipeAlloc();
+        if(!r) continue;
+        r->len = strnlen(l.s, sizeof(l.s));
+        memcpy(r->text, l.s, r->len);
+        r->text[r->len] = 0;
+        r->kind = PIPE_N2K; r->pgn = l.pgn; r->n2kSrc = l.src; r->rxUs = l.rxUs;
+        pipeSubmit(r);
+      }
     }
 
     // GENERATOR
     if(appMode==MODE_GENERATOR && generatorRunning){
       unsigned long now=millis();
+      const GenConfig* cfg = genAcquire();           // snapshot inmutable, sin locks
       for(int i=0;i<MAX_SLOTS;i++){
-        if(!slots[i].enabled) continue;
-        if(now-lastSentMs[i] >= slotInterval[i]){
+        const GenSlotCfg& g = cfg->slot[i];
+        if(!g.enabled) continue;
+        if(now-lastSentMs[i] >= g.intervalMs){
           lastSentMs[i]=now;
-          String out = slots[i].text.length()?slots[i].text:generateSentence(slots[i].sensor,slots[i].sentence);
-          if(out.length()==0) continue;
-
-          stampGen(slots[i].sensor);
+          char out[GEN_TEXT_LEN+4];
+          size_t n = g.text[0] ? strnlen(g.text, GEN_TEXT_LEN-1) : sentenceRender(g.sensor, g.sentence, out);
+          if(n==0) continue;
+          const char* line = g.text[0] ? g.text : out;
 
           xSemaphoreTake(serialMutex,portMAX_DELAY);
-          NMEA_Serial.println(out);
+          NMEA_Serial.write((const uint8_t*)line, n);
+          NMEA_Serial.write((const uint8_t*)"\r\n", 2);
           xSemaphoreGive(serialMutex);
-          sendUDP(out);
-          pushGen(out);
-          flashLed(pixels.Color(0,0,255)); // TX azul
+          ledEvent(LED_EV_TX);
+
+          PipeRec* r = pipeAlloc();
+          if(!r) continue;
+          r->len = n;
+          memcpy(r->text, line, n);
+          r->text[n] = 0;
+          r->kind = PIPE_GEN;
+          r->cat  = sensorIndexByName(g.sensor);
+          pipeSubmit(r);
         }
       }
+      genRelease();
     }
 
-    updateLed();
     vTaskDelay(1);
   }
 }
 
+// Proceso: todo lo que no es ni UART ni red. Un solo escritor de streams[],
+// vessel, dedup e historial.
+void TaskProc(void*){
+  for(;;){
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    PipeRec* r;
+    while(pipeProcQ.pop(r)){
+      uint32_t t0 = stampUs();
+      if(r->kind==PIPE_GEN) procGen(*r);
+      else                  procRx(*r);
+      uint32_t t1 = stampUs();
+      pipeProcStat.record(t0 - r->queuedUs, t1 - t0);
+      r->queuedUs = t1;
+      pipeOutQ.push(r);                      // también sin salidas: TaskOut lo devuelve al pool
+      xTaskNotifyGive(pipeOutTask);
+    }
+  }
+}
+
+// Salida: UDP/TCP/IEC 450/Signal K. Se despierta por cada registro o cada
+// PIPE_OUT_TICK_MS para vencer los lotes (IEC_BATCH_MS, SK_BATCH_MS).
+static const uint32_t PIPE_OUT_TICK_MS = 5;
+void TaskOut(void*){
+  for(;;){
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PIPE_OUT_TICK_MS));
+    PipeRec* r;
+    while(pipeOutQ.pop(r)){
+      uint32_t t0 = stampUs();
+      outRecord(*r);
+      pipeOutStat.record(t0 - r->queuedUs, stampUs() - t0);
+      pipeFreeQ.push(r);
+    }
+    uint32_t now = millis();
+    iecFlushIfDue(now);
+    skFlushIfDue(now);
+  }
+}
+
 void TaskUI(void*){
-  // Splash
+  // Splash (salteable por config)
   bootStartMs = millis();
-  while(millis() - bootStartMs < SPLASH_MS){
+  while(!cfgSkipSplash && millis() - bootStartMs < SPLASH_MS){
     drawSplash(millis());
     vTaskDelay(40);
   }
+  oledInvalidate();   // el splash usó sendBuffer(): el primer frame va completo
   for(;;){
+    pollPage();
+    statsSample();
     drawStatus();
-    vTaskDelay(120);
+    saveConfigIfDue();
+    vTaskDelay(50);     // frames sin cambios no cuestan SPI → se puede refrescar más seguido
   }
 }
 
@@ -1101,10 +3372,32 @@ void setup(){
   u8g2.begin();
 
   pixels.begin(); pixels.show();
+  pinMode(BTN_PIN, INPUT_PULLUP);
 
   nmeaBufMutex=xSemaphoreCreateMutex();
   genBufMutex =xSemaphoreCreateMutex();
   serialMutex =xSemaphoreCreateMutex();
+  slotWriteMutex=xSemaphoreCreateMutex();
+  tcpMutex      =xSemaphoreCreateMutex();
+  n2kQueue      =xQueueCreate(32, sizeof(N2kLine));
+  otaQueue      =xQueueCreate(OTA_SLOTS+4, sizeof(OtaMsg));
+  otaFree       =xQueueCreate(OTA_SLOTS, sizeof(uint8_t));
+  otaAckMux     =xSemaphoreCreateMutex();
+  for(uint8_t i=0;i<OTA_SLOTS;i++) xQueueSend(otaFree, &i, 0);
+
+  // Config persistida → UART y NMEA arrancan antes que el Wi-Fi (reanudación rápida)
+  histBegin();
+  bool cfgOk = loadConfig();
+  ledEvent(LED_EV_BOOT);
+  startSerial(currentBaud);
+  for(auto& r : pipePool) pipeFreeQ.push(&r);
+  xTaskCreatePinnedToCore(TaskOut,  "TaskOut",  4096, NULL, PIPE_PRIO_OUT,    &pipeOutTask,  PIPE_CORE_OUT);
+  xTaskCreatePinnedToCore(TaskProc, "TaskProc", 6144, NULL, PIPE_PRIO_PROC,   &pipeProcTask, PIPE_CORE_PROC);
+  xTaskCreatePinnedToCore(TaskNMEA, "TaskNMEA", 4096, NULL, PIPE_PRIO_INGEST, NULL,          PIPE_CORE_INGEST);
+  xTaskCreatePinnedToCore(TaskUI,   "TaskUI",   4096, NULL, 1, NULL, 0);
+  xTaskCreatePinnedToCore(TaskCAN,  "TaskCAN",  4096, NULL, 2, NULL, 1);
+  xTaskCreatePinnedToCore(TaskOTA,  "TaskOTA",  4096, NULL, 1, NULL, 0);
+  xTaskCreatePinnedToCore(TaskLED,  "TaskLED",  2048, NULL, 1, NULL, 0);
 
   WiFi.mode(WIFI_AP);
   WiFi.softAP(AP_SSID, AP_PASSWORD);
@@ -1113,10 +3406,9 @@ void setup(){
   dnsServer.start(DNS_PORT, "*", apIP);
   MDNS.begin("nmeareader"); MDNS.addService("http","tcp",80);
 
-  flashLed(pixels.Color(0,255,255)); // boot
-  startSerial(currentBaud);
-
   udpAddress = apIP; udpAddress[3]=255; // broadcast 192.168.4.255
+  tcpBegin();                            // NMEA sobre TCP :10110
+  netReady = true;
 
   // Captive helpers
   server.on("/generate_204", handleCaptive);
@@ -1132,10 +3424,7 @@ void setup(){
   server.on("/monitor",   handleMonitor);
   server.on("/generator", handleGenerator);
   server.on("/update",    HTTP_GET, handleUpdatePage);
-  server.on("/update",    HTTP_POST,
-    [](){ noCache(); server.sendHeader("Connection","close"); server.send(200,"text/plain",Update.hasError()?"FAIL":"OK"); delay(800); ESP.restart(); },
-    handleUpdateUpload
-  );
+  server.on("/update",    HTTP_POST, handleUpdateDone, handleUpdateUpload);
 
   // API comunes
   server.on("/getnmea",   handleGetNMEA);
@@ -1143,25 +3432,51 @@ void setup(){
   server.on("/setmode",   handleSetMode);
   server.on("/setmonitor",handleSetMonitor);
   server.on("/clearnmea", handleClearNMEA);
+  server.on("/setfilters",handleSetFilters);
+  server.on("/setconfig", handleSetConfig);
 
   // API generator
   server.on("/togglegen",        handleToggleGen);
   server.on("/getgen",           handleGetGen);
   server.on("/cleargen",         handleClearGen);
   server.on("/getstatus",        handleGetStatus);
+  server.on("/streams",          handleStreams);
+  server.on("/vessel",           handleVessel);
+  server.on("/signalk",          handleSignalK);
+  server.on("/latency",          handleLatency);
+  server.on("/search",           handleSearch);
+  server.on("/pipeline",         handlePipeline);
+  server.on("/otastatus",        handleOtaStatus);
+  skWs.onEvent(skOnEvent);
+  server.addHandler(&skWs);
+  server.on("/outputs",          handleOutputs);
+  server.on("/setoutput",        handleSetOutput);
+  server.on("/idrule",           handleIdRule);
+  server.on("/gen_slots",        HTTP_GET, handleGenSlots);
+  server.on("/sentences",        HTTP_GET, handleSentences);
   server.on("/gen_slot_enable",  handleGenSlotEnable);
   server.on("/gen_slot_sensor",  handleGenSlotSensor);
   server.on("/gen_slot_sentence",handleGenSlotSentence);
   server.on("/gen_slot_template",handleGenSlotTemplate);
-  server.on("/gen_slot_text",    HTTP_POST, handleGenSlotText_POST);
-  server.on("/gen_slot_text",    HTTP_GET,  handleGenSlotText_GET);
+  server.on("/gen_slot_text",    HTTP_GET|HTTP_POST, handleGenSlotText);
   server.on("/gen_slot_interval",handleGenSlotInterval);
+  AsyncCallbackJsonWebHandler* slotHandler = new AsyncCallbackJsonWebHandler("/gen_slot", handleGenSlotJson);
+  slotHandler->setMethod(HTTP_POST);
+  server.addHandler(slotHandler);
+
+  // Estáticos versionados (CSS/JS): cache larga
+  for(size_t i=0;i<WEB_ASSET_COUNT;i++){
+    if(!WEB_ASSETS[i].immutable) continue;
+    const WebAsset* a=&WEB_ASSETS[i];
+    server.on(a->path, HTTP_GET, [a](AsyncWebServerRequest* req){ sendAsset(req,*a); });
+  }
 
   // NotFound → redirige a menú
-  server.onNotFound([](){
-    noCache();
-    server.sendHeader("Location", String("http://")+WiFi.softAPIP().toString()+"/", true);
-    server.send(302,"text/plain","");
+  server.onNotFound([](AsyncWebServerRequest* req){
+    AsyncWebServerResponse* res=req->beginResponse(302,"text/plain","");
+    noCache(res);
+    res->addHeader("Location", String("http://")+WiFi.softAPIP().toString()+"/");
+    req->send(res);
   });
 
   server.begin();
@@ -1172,12 +3487,12 @@ void setup(){
   Serial.print( "📄 IP (AP): " ); Serial.println(apIP.toString());
   Serial.print( "🌐 UDP broadcast: " ); Serial.print(udpAddress.toString()); Serial.print(":"); Serial.println(udpPort);
   Serial.printf("🔧 UART RX=%d  TX=%d  baud=%d\n", RX_PIN, TX_PIN, currentBaud);
-  Serial.println("✅ HTTP server + DNS (captive) listos");
-  Serial.println("🧵 Tasks: Net(core0) + NMEA(core1) + UI(core0)");
+  Serial.printf("💾 Config NVS: %s%s\n", cfgOk ? "restaurada" : "por defecto", cfgAutoResume ? " (auto-resume)" : "");
+  Serial.println("✅ HTTP server (async) + DNS (captive) listos");
+  Serial.printf("🧵 Tasks: NMEA(core%d) → Proc(core%d) → Out(core%d) + CAN(core1) + UI/LED/OTA/Net/AsyncTCP(core0)\n",
+                (int)PIPE_CORE_INGEST, (int)PIPE_CORE_PROC, (int)PIPE_CORE_OUT);
 
   xTaskCreatePinnedToCore(TaskNet,  "TaskNet",  4096, NULL, 1, NULL, 0);
-  xTaskCreatePinnedToCore(TaskNMEA, "TaskNMEA", 6144, NULL, 2, NULL, 1);
-  xTaskCreatePinnedToCore(TaskUI,   "TaskUI",   4096, NULL, 1, NULL, 0);
 }
 
 void loop(){ /* vacío (todo corre en tasks) */ }
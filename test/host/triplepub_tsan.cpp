@@ -0,0 +1,61 @@
+/* ==============================================================
+   Stress de lib/TriplePub bajo ThreadSanitizer
+   N escritores (serializados por un mutex, como slotWriteMutex en el
+   firmware) publican versiones; 1 lector las toma sin locks y verifica
+   que ninguna esté a medio escribir ni vuelva atrás.
+
+     make && ./triplepub_tsan
+   ============================================================== */
+#include "TriplePub.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const int WORDS    = 64;          // ≈ GenConfig: copia no atómica
+static const int WRITERS  = 4;
+static const int PUBLISH  = 50000;       // por escritor
+
+struct Cfg { unsigned v[WORDS]; };
+
+int main(int argc, char** argv){
+  const int writers = argc > 1 ? atoi(argv[1]) : WRITERS;
+  Cfg init;
+  for(int i=0;i<WORDS;i++) init.v[i] = (unsigned)i;        // versión 0, ya con el patrón
+  TriplePub<Cfg> pub(init);
+  std::mutex wr;
+  std::atomic<bool> done(false);
+  std::atomic<unsigned> bad(0);
+  unsigned reads = 0, last = 0;
+
+  std::thread reader([&]{
+    while(!done.load(std::memory_order_acquire)){
+      const Cfg* c = pub.acquire();
+      unsigned v0 = c->v[0];
+      for(int i=1;i<WORDS;i++) if(c->v[i] != v0 + (unsigned)i){ bad++; break; }
+      if(v0 < last) bad++;                                  // versión vieja reciclada
+      last = v0;
+      pub.release();
+      reads++;
+    }
+  });
+
+  std::vector<std::thread> ws;
+  unsigned next = 0;                                        // bajo wr
+  for(int w=0; w<writers; w++) ws.emplace_back([&]{
+    for(int k=0;k<PUBLISH;k++){
+      std::lock_guard<std::mutex> lk(wr);
+      unsigned v = ++next;
+      pub.publish([v](Cfg& c){ for(int i=0;i<WORDS;i++) c.v[i] = v + (unsigned)i; });
+    }
+  });
+  for(auto& t : ws) t.join();
+  done.store(true, std::memory_order_release);
+  reader.join();
+
+  fprintf(stderr, "writers=%d publish=%d reads=%u bad=%u last=%u\n",
+          writers, writers*PUBLISH, reads, bad.load(), last);
+  return bad.load() ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+"""
+Empaqueta la UI estática (web/) en include/web_assets.h.
+
+- Cada archivo se comprime con gzip (nivel 9, mtime=0 → salida determinista).
+- ETag = primeros 16 hex del SHA-1 del contenido original.
+- Las referencias a CSS/JS dentro de los HTML se reescriben a '/x.js?v=<etag>',
+  así esos recursos pueden servirse con cache larga ('immutable').
+
+Se ejecuta como pre-script de PlatformIO (extra_scripts) o a mano:
+    python tools/embed_web.py
+"""
+import gzip
+import hashlib
+import os
+import re
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+WEB_DIR = os.path.join(ROOT, "web")
+OUT = os.path.join(ROOT, "include", "web_assets.h")
+
+MIME = {
+    ".html": "text/html; charset=utf-8",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".svg": "image/svg+xml",
+}
+
+
+def ident(name):
+    return "WA_" + re.sub(r"[^0-9A-Za-z]", "_", name)
+
+
+def etag_of(data):
+    return hashlib.sha1(data).hexdigest()[:16]
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), 20):
+        lines.append("  " + ",".join("0x%02x" % b for b in data[i:i + 20]) + ",")
+    return "\n".join(lines)
+
+
+def build():
+    names = sorted(f for f in os.listdir(WEB_DIR)
+                   if os.path.splitext(f)[1] in MIME)
+    raw = {}
+    for n in names:
+        with open(os.path.join(WEB_DIR, n), "rb") as fh:
+            raw[n] = fh.read()
+
+    # 1) Recursos inmutables (todo lo que no es HTML)
+    etags = {n: etag_of(raw[n]) for n in names if not n.endswith(".html")}
+
+    # 2) HTML: versionar referencias a recursos
+    for n in names:
+        if not n.endswith(".html"):
+            continue
+        text = raw[n].decode("utf-8")
+        for ref, tag in etags.items():
+            text = re.sub(r"(['\"])/%s\1" % re.escape(ref),
+                          lambda m, r=ref, t=tag: "%s/%s?v=%s%s" % (m.group(1), r, t, m.group(1)),
+                          text)
+        raw[n] = text.encode("utf-8")
+        etags[n] = etag_of(raw[n])
+
+    out = []
+    out.append("// Generado por tools/embed_web.py — NO EDITAR (fuente en web/)")
+    out.append("#pragma once")
+    out.append("#include <Arduino.h>")
+    out.append("")
+    out.append("struct WebAsset {")
+    out.append("  const char*    path;       // ruta HTTP")
+    out.append("  const char*    mime;")
+    out.append("  const uint8_t* gz;         // contenido gzip en flash")
+    out.append("  size_t         len;")
+    out.append("  const char*    etag;       // entre comillas, listo para el header")
+    out.append("  bool           immutable;  // CSS/JS versionados → cache larga")
+    out.append("};")
+    out.append("")
+    rows = []
+    total_raw = total_gz = 0
+    for n in names:
+        gz = gzip.compress(raw[n], compresslevel=9, mtime=0)
+        total_raw += len(raw[n])
+        total_gz += len(gz)
+        out.append("static const uint8_t %s[] PROGMEM = {" % ident(n))
+        out.append(c_bytes(gz))
+        out.append("};")
+        path = "/" + n
+        mime = MIME[os.path.splitext(n)[1]]
+        rows.append('  {"%s", "%s", %s, sizeof(%s), "\\"%s\\"", %s},'
+                    % (path, mime, ident(n), ident(n), etags[n],
+                       "false" if n.endswith(".html") else "true"))
+    out.append("")
+    out.append("static const WebAsset WEB_ASSETS[] = {")
+    out.extend(rows)
+    out.append("};")
+    out.append("static const size_t WEB_ASSET_COUNT = sizeof(WEB_ASSETS)/sizeof(WEB_ASSETS[0]);")
+    out.append("// raw=%d bytes, gzip=%d bytes" % (total_raw, total_gz))
+    out.append("")
+    text = "\n".join(out)
+
+    old = None
+    if os.path.exists(OUT):
+        with open(OUT, "r", encoding="utf-8") as fh:
+            old = fh.read()
+    if old != text:  # no tocar el mtime si no cambió (evita recompilar)
+        with open(OUT, "w", encoding="utf-8") as fh:
+            fh.write(text)
+    print("web_assets.h: %d files, %d -> %d bytes gzip" % (len(names), total_raw, total_gz))
+
+
+try:
+    Import("env")  # noqa: F821  (PlatformIO)
+except NameError:
+    pass
+
+build()
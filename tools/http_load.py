@@ -0,0 +1,91 @@
+"""
+Carga HTTP concurrente contra el equipo (o cualquier host que sirva la misma API).
+
+Simula N teléfonos: cada uno abre una conexión keep-alive y repite
+'/getnmea' + '/getstatus'. Con --slow se agrega un cliente que envía un POST
+a cuentagotas, para verificar que una conexión lenta no bloquea al resto.
+
+    python tools/http_load.py --host 192.168.4.1 --clients 8 --seconds 20
+
+Sólo usa la stdlib.
+"""
+import argparse
+import http.client
+import statistics
+import threading
+import time
+
+
+def worker(host, port, deadline, paths, stats, lock):
+    lat = []
+    errors = 0
+    conn = http.client.HTTPConnection(host, port, timeout=5)
+    while time.time() < deadline:
+        for p in paths:
+            t0 = time.perf_counter()
+            try:
+                conn.request("GET", p, headers={"Connection": "keep-alive"})
+                r = conn.getresponse()
+                r.read()
+                lat.append(time.perf_counter() - t0)
+            except Exception:
+                errors += 1
+                conn.close()
+                conn = http.client.HTTPConnection(host, port, timeout=5)
+    conn.close()
+    with lock:
+        stats["lat"].extend(lat)
+        stats["err"] += errors
+
+
+def slow_client(host, port, deadline):
+    # Cliente lento: abre una conexión y envía de a poco (no debe frenar al resto)
+    conn = http.client.HTTPConnection(host, port, timeout=30)
+    try:
+        conn.putrequest("POST", "/clearnmea")
+        conn.putheader("Content-Length", "100000")
+        conn.endheaders()
+        while time.time() < deadline:
+            conn.send(b"x" * 64)
+            time.sleep(0.5)
+    except Exception:
+        pass
+    finally:
+        conn.close()
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--host", default="192.168.4.1")
+    ap.add_argument("--port", type=int, default=80)
+    ap.add_argument("--clients", type=int, default=8)
+    ap.add_argument("--seconds", type=float, default=20)
+    ap.add_argument("--slow", action="store_true", help="agrega un cliente lento")
+    args = ap.parse_args()
+
+    deadline = time.time() + args.seconds
+    stats = {"lat": [], "err": 0}
+    lock = threading.Lock()
+    threads = [threading.Thread(target=worker,
+                                args=(args.host, args.port, deadline,
+                                      ["/getnmea", "/getstatus"], stats, lock))
+               for _ in range(args.clients)]
+    if args.slow:
+        threads.append(threading.Thread(target=slow_client, args=(args.host, args.port, deadline)))
+    t0 = time.time()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    dt = time.time() - t0
+
+    lat = sorted(stats["lat"])
+    n = len(lat)
+    print("clients=%d  requests=%d  errors=%d  %.1f req/s" % (args.clients, n, stats["err"], n / dt))
+    if n:
+        print("latency ms: p50=%.1f p95=%.1f max=%.1f mean=%.1f" % (
+            lat[n // 2] * 1e3, lat[int(n * 0.95) - 1] * 1e3, lat[-1] * 1e3, statistics.mean(lat) * 1e3))
+
+
+if __name__ == "__main__":
+    main()
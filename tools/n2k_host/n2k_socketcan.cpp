@@ -0,0 +1,133 @@
+/* ==============================================================
+   n2k_socketcan — lib/N2K en Linux, sin bus real
+   - Lee tramas de SocketCAN (can0 / vcan0) o de un log de candump -L
+   - Imprime las sentencias 0183 generadas y, opcional, las manda por UDP
+     (p. ej. a OpenCPN o a un servidor Signal K en la PC)
+
+     make
+     ./n2k_socketcan -i vcan0
+     ./n2k_socketcan -r sample.log
+     ./n2k_socketcan -i vcan0 -u 127.0.0.1:10110
+   ============================================================== */
+#include "N2K.h"
+
+#include <arpa/inet.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static int udpSock = -1;
+static sockaddr_in udpDst;
+
+static void emit(const char* s, uint32_t pgn, uint8_t src, void*){
+  printf("%-7u %3u  %s\n", pgn, src, s);
+  if(udpSock >= 0){
+    std::string line = std::string(s) + "\r\n";
+    sendto(udpSock, line.data(), line.size(), 0, (sockaddr*)&udpDst, sizeof(udpDst));
+  }
+}
+
+static uint32_t nowMs(){
+  timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec*1000 + ts.tv_nsec/1000000);
+}
+
+// "(1699999999.123456) vcan0 09F80103#A0B1C2D3E4F50617"
+static bool parseCandump(const char* line, N2kFrame& f, uint32_t& ms){
+  double t; char ifn[32], frame[64];
+  if(sscanf(line, " (%lf) %31s %63s", &t, ifn, frame) != 3) return false;
+  char* hash = strchr(frame, '#');
+  if(!hash || hash - frame != 8) return false;                 // sólo IDs extendidos
+  *hash = 0;
+  f.id = (uint32_t)strtoul(frame, nullptr, 16) & CAN_EFF_MASK;
+  const char* p = hash + 1;
+  f.len = 0;
+  while(p[0] && p[1] && f.len < 8){
+    char hx[3] = {p[0], p[1], 0};
+    f.data[f.len++] = (uint8_t)strtoul(hx, nullptr, 16);
+    p += 2;
+  }
+  ms = (uint32_t)(uint64_t)(t * 1000.0);                    // época en ms: se trunca a 32 bits a propósito
+  return true;
+}
+
+static int openCan(const char* ifname){
+  int s = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+  if(s < 0){ perror("socket"); return -1; }
+  ifreq ifr; memset(&ifr, 0, sizeof(ifr));
+  strncpy(ifr.ifr_name, ifname, IFNAMSIZ-1);
+  if(ioctl(s, SIOCGIFINDEX, &ifr) < 0){ perror(ifname); close(s); return -1; }
+  sockaddr_can addr; memset(&addr, 0, sizeof(addr));
+  addr.can_family = AF_CAN;
+  addr.can_ifindex = ifr.ifr_ifindex;
+  if(bind(s, (sockaddr*)&addr, sizeof(addr)) < 0){ perror("bind"); close(s); return -1; }
+  return s;
+}
+
+static void usage(){
+  fprintf(stderr, "uso: n2k_socketcan (-i <ifname> | -r <candump.log>) [-u host:puerto]\n");
+  exit(2);
+}
+
+int main(int argc, char** argv){
+  const char* ifname = nullptr;
+  const char* replay = nullptr;
+  for(int i=1;i<argc;i++){
+    if(!strcmp(argv[i], "-i") && i+1<argc) ifname = argv[++i];
+    else if(!strcmp(argv[i], "-r") && i+1<argc) replay = argv[++i];
+    else if(!strcmp(argv[i], "-u") && i+1<argc){
+      std::string hp = argv[++i];
+      size_t c = hp.rfind(':');
+      if(c == std::string::npos) usage();
+      memset(&udpDst, 0, sizeof(udpDst));
+      udpDst.sin_family = AF_INET;
+      udpDst.sin_port = htons((uint16_t)atoi(hp.c_str()+c+1));
+      if(inet_pton(AF_INET, hp.substr(0, c).c_str(), &udpDst.sin_addr) != 1) usage();
+      udpSock = socket(AF_INET, SOCK_DGRAM, 0);
+      int one = 1; setsockopt(udpSock, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+    }
+    else usage();
+  }
+  if(!ifname == !replay) usage();
+
+  N2kToNmea conv(emit, nullptr);
+
+  if(replay){
+    FILE* fp = fopen(replay, "r");
+    if(!fp){ perror(replay); return 1; }
+    char line[256];
+    while(fgets(line, sizeof(line), fp)){
+      N2kFrame f; uint32_t ms;
+      if(parseCandump(line, f, ms)) conv.onFrame(f, ms);
+    }
+    fclose(fp);
+  } else {
+    int s = openCan(ifname);
+    if(s < 0) return 1;
+    can_frame cf;
+    while(read(s, &cf, sizeof(cf)) == (ssize_t)sizeof(cf)){
+      if(!(cf.can_id & CAN_EFF_FLAG) || (cf.can_id & CAN_RTR_FLAG)) continue;
+      N2kFrame f;
+      f.id = cf.can_id & CAN_EFF_MASK;
+      f.len = cf.can_dlc > 8 ? 8 : cf.can_dlc;
+      memcpy(f.data, cf.data, 8);
+      conv.onFrame(f, nowMs());
+      fflush(stdout);
+    }
+    close(s);
+  }
+
+  const N2kToNmea::Stats& st = conv.stats();
+  fprintf(stderr, "frames=%u decoded=%u ignored=%u fp_complete=%u fp_dropped=%u\n",
+          st.frames, st.decoded, st.ignored, st.fpComplete, st.fpDropped);
+  return 0;
+}
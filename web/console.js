@@ -0,0 +1,62 @@
+// Consola virtualizada (monitor y generador).
+// - Guarda hasta 'max' líneas en memoria; en el DOM sólo están las filas visibles
+//   (+ margen), todas de alto fijo, dentro de un contenedor del alto total.
+// - Pide al equipo sólo lo nuevo: GET url?since=<seq> → "<seq> <perdidas>\n" + líneas.
+// - Lo que llega se junta y se pinta en un requestAnimationFrame: siguiendo el
+//   final, se agregan filas abajo y se sacan arriba, sin rehacer la ventana.
+// - run(active) sondea solo: espera lo que sugiere el equipo (X-Poll-Ms), pide
+//   antes si llegó una ráfaga o se perdieron líneas, y se aleja ante 503/errores
+//   o si active() da falso (pausa, pestaña oculta).
+// fill(div,line) arma una fila (textContent, nunca innerHTML); accept(line) filtra.
+function VConsole(el,url,opt){
+  opt=opt||{};
+  const ROW=18,OVER=8,MAX=opt.max||5000;
+  const fill=opt.fill||((d,l)=>{d.textContent=l;}),accept=opt.accept||(()=>true);
+  const PMIN=150,PMAX=5000,PIDLE=1000;
+  let lines=[],base=0,seq=0,wf=0,wl=0,raf=0,busy=false,stick=true,redo=false,next=1000,back=0;
+  el.textContent='';el.classList.add('vcon');
+  const sizer=document.createElement('div'),win=document.createElement('div');
+  sizer.className='vsz';win.className='vwin';sizer.appendChild(win);el.appendChild(sizer);
+  function row(i){const d=document.createElement('div'),l=lines[i-base];d.className='vrow';
+    if(typeof l==='string')fill(d,l);else{d.classList.add('vgap');d.textContent='… '+l.gap+' …';}return d;}
+  function paint(){raf=0;
+    const total=base+lines.length;
+    sizer.style.height=(lines.length*ROW)+'px';
+    if(stick)el.scrollTop=el.scrollHeight;
+    const top=el.scrollTop,h=el.clientHeight||300;
+    const f=Math.max(base,base+Math.floor(top/ROW)-OVER),l=Math.min(total,base+Math.ceil((top+h)/ROW)+OVER);
+    if(redo||f<wf||f>=wl){win.textContent='';wf=wl=f;redo=false;}
+    while(wf<f&&win.firstChild){win.removeChild(win.firstChild);wf++;}
+    while(wl>l&&win.lastChild){win.removeChild(win.lastChild);wl--;}
+    if(wl<l){const fr=document.createDocumentFragment();for(;wl<l;wl++)fr.appendChild(row(wl));win.appendChild(fr);}
+    win.style.transform='translateY('+((wf-base)*ROW)+'px)';}
+  function schedule(){if(!raf)raf=requestAnimationFrame(paint);}
+  function add(arr){for(const l of arr)lines.push(l);
+    if(lines.length>MAX){const cut=lines.length-MAX;lines.splice(0,cut);base+=cut;}
+    schedule();}
+  function clear(){base+=lines.length;lines=[];redo=true;schedule();}
+  el.addEventListener('scroll',()=>{stick=el.scrollTop+el.clientHeight>=el.scrollHeight-ROW;schedule();},{passive:true});
+  // Devuelve la espera sugerida hasta el próximo pedido (ms)
+  async function poll(){if(busy)return next;busy=true;
+    try{const r=await fetch(url+'?since='+seq+'&ts='+Date.now()),hint=+r.headers.get('X-Poll-Ms')||0;
+      if(!r.ok){back=Math.min(PMAX,Math.max(hint,back*2||1000));next=back;busy=false;return next;}   // saturado
+      back=0;
+      const t=await r.text();
+      const nl=t.indexOf('\n'),head=(nl<0?t:t.substring(0,nl)).split(' '),s=+head[0],lost=+head[1]||0;
+      if(!isNaN(s)){
+        if(s<seq)clear();                         // el equipo reinició
+        seq=s;
+        const arr=nl<0?[]:t.substring(nl+1).split('\n');arr.pop();
+        const got=arr.filter(accept);
+        if(lost>0)got.unshift({gap:lost});
+        if(got.length)add(got);
+        next=hint||next;
+        if(lost>0||arr.length>=40)next=Math.max(PMIN,next>>1);   // ráfaga: no quedarse atrás
+      }
+    }catch(e){back=Math.min(PMAX,back*2||1000);next=back;}
+    busy=false;return next;}
+  function run(active){active=active||(()=>true);
+    (async function loop(){const ms=active()?await poll():Math.max(next,PIDLE);
+      setTimeout(loop,Math.min(PMAX,Math.max(PMIN,ms)));})();}
+  return {poll:poll,run:run,clear:clear,refresh(){redo=true;schedule();}};
+}
@@ -0,0 +1,54 @@
+// Catálogo sensor → sentencias: lo manda el equipo (GET /sentences, misma tabla que el generador)
+let sentencesBySensor={},SENSORS=[];
+const INTERVALS=[[100,'0.1s'],[500,'0.5s'],[1000,'1s'],[2000,'2s']];
+let lang=localStorage.getItem('lang')||'en';
+const L={en:{title:'NMEA Generator',sensor:'Sensor',sentenceSel:'Sentence type',sentenceInline:'Sentence',interval:'Interval',start:'▶ Start',pause:'⏸ Pause',clear:'🧹 Clear',back:'⬅ NMEA Monitor',baud:'Baudrate'},
+es:{title:'NMEA Generator',sensor:'Sensor',sentenceSel:'Tipo de sentencia',sentenceInline:'Sentencia',interval:'Intervalo',start:'▶ Iniciar',pause:'⏸ Pausar',clear:'🧹 Limpiar',back:'⬅ NMEA Monitor',baud:'Baudrate'},
+fr:{title:'NMEA Generator',sensor:'Capteur',sentenceSel:'Type de trame',sentenceInline:'Trame',interval:'Intervalle',start:'▶ Démarrer',pause:'⏸ Pause',clear:'🧹 Effacer',back:'⬅ NMEA Monitor',baud:'Baudrate'}};
+function hex2(n){return n.toString(16).toUpperCase().padStart(2,'0');}
+function csPayload(s){let cs=0;for(let i=0;i<s.length;i++){cs^=s.charCodeAt(i);}return hex2(cs);}
+function buildFullFromEditor(str){ if(!str) return ''; str=str.trim(); let ch=null; if(str[0]==='$'||str[0]==='!'){ ch=str[0]; str=str.slice(1);} let up=str.toUpperCase(); if(!ch) ch=(up.startsWith('AIVDM')||up.startsWith('AIVDO'))?'!':'$'; let payload=str; return ch+payload+'*'+csPayload(payload);}
+function fillOptions(sel,arr,selected){sel.innerHTML='';for(let i=0;i<arr.length;i++){let o=document.createElement('option');o.value=arr[i];o.text=arr[i];if(arr[i]===selected)o.selected=true;sel.appendChild(o);}}
+function refillSent(sensorSel,sentSel,selected){const arr=sentencesBySensor[sensorSel.value]||[];fillOptions(sentSel,arr.length?arr:['CUSTOM'],selected);}
+async function getStatus(){try{const r=await fetch('/getstatus');return await r.json();}catch(e){return {baud:4800,genRunning:false};}}
+async function getCatalog(){try{const r=await fetch('/sentences');sentencesBySensor=await r.json();}catch(e){sentencesBySensor={CUSTOM:[]};}SENSORS=Object.keys(sentencesBySensor);}
+async function getSlots(){try{const r=await fetch('/gen_slots');return await r.json();}catch(e){return [];}}
+function buildSlot(i,s){
+  const card=document.createElement('div');card.className='card';card.id='slot_'+i;
+  card.innerHTML=
+    "<div class='row'><div class='col'><label class='label-inline'><input type='checkbox' id='en_"+i+"'><span class='lblSensor'>Sensor</span></label><select id='sensor_"+i+"'></select></div>"+
+    "<div class='col'><label class='lblSentence'>Sentence type</label><select id='sentence_"+i+"'></select></div></div>"+
+    "<div class='row spaceTop'><div style='flex:1 1 100%'><input id='text_"+i+"' placeholder='$GPRMC,...' autocomplete='off'></div></div>"+
+    "<div class='row spaceTop'><div style='flex:1 1 100%'><label class='lblIntervalSlot'>Interval</label><div id='intgrp_"+i+"' class='row' style='gap:8px'>"+
+    INTERVALS.map(v=>"<button type='button' class='btn small int-btn"+(s.ms===v[0]?" active":"")+"' onclick='setIntervalSlot("+i+","+v[0]+",this)'>"+v[1]+"</button>").join('')+
+    "</div></div></div>";
+  document.getElementById('slots').appendChild(card);
+  document.getElementById('en_'+i).checked=!!s.en;
+  const sensorSel=document.getElementById('sensor_'+i);fillOptions(sensorSel,SENSORS,s.sensor);
+  refillSent(sensorSel,document.getElementById('sentence_'+i),s.sentence);
+  document.getElementById('text_'+i).value=s.text||'';
+}
+// Un solo POST /gen_slot por edición (JSON con el slot completo); el texto se envía con debounce
+const DEBOUNCE_MS=300;let pending={};
+function slotState(i){return {i:i,en:document.getElementById('en_'+i).checked,sensor:document.getElementById('sensor_'+i).value,sentence:document.getElementById('sentence_'+i).value,text:buildFullFromEditor(document.getElementById('text_'+i).value)};}
+async function pushSlot(i,extra){if(pending[i]){clearTimeout(pending[i]);delete pending[i];}
+  const body=Object.assign(slotState(i),extra||{});
+  try{const r=await fetch('/gen_slot',{method:'POST',headers:{'Content-Type':'application/json'},body:JSON.stringify(body)});return await r.json();}catch(e){return null;}}
+function pushSlotLater(i){if(pending[i])clearTimeout(pending[i]);pending[i]=setTimeout(()=>{delete pending[i];pushSlot(i);},DEBOUNCE_MS);}
+function initSlot(i){const en=document.getElementById('en_'+i),sensorSel=document.getElementById('sensor_'+i),sentSel=document.getElementById('sentence_'+i),txt=document.getElementById('text_'+i);
+ en.addEventListener('change',()=>{pushSlot(i);});
+ sensorSel.addEventListener('change',async ()=>{refillSent(sensorSel,sentSel);const s=await pushSlot(i,{tpl:true});if(s)txt.value=s.text;});
+ sentSel.addEventListener('change',async ()=>{const s=await pushSlot(i,{tpl:true});if(s)txt.value=s.text;});
+ txt.addEventListener('input',e=>{ if(e.target.value.indexOf('*')>=0){ e.target.value=e.target.value.replace(/\*/g,''); } pushSlotLater(i);});
+ txt.addEventListener('blur',()=>{if(pending[i])pushSlot(i);});
+}
+function setActive(sel,scope,el){(scope||document).querySelectorAll(sel).forEach(b=>b.classList.remove('active')); if(el) el.classList.add('active');}
+function setIntervalSlot(i,ms,btn){pushSlot(i,{ms:ms}).then(s=>{if(!s)return;const g=document.getElementById('intgrp_'+i);if(!g)return;setActive('.int-btn',g,btn);});}
+async function setGenBaud(b,btn){try{await fetch('/setbaud?baud='+b);setActive('.gen-baud',document,btn);}catch(e){}}
+let running=false;
+async function toggleGen(e){if(e)e.preventDefault();try{running=!running;const r=await fetch('/togglegen?state='+(running?'1':'0'));const t=await r.text();running=(t==='RUNNING');document.getElementById('startBtn').innerText=running?L[lang].pause:L[lang].start;}catch(err){}}
+let con=null;
+function clearGen(e){if(e)e.preventDefault();fetch('/cleargen').catch(()=>{});if(con)con.clear();}
+function applyLang(){document.getElementById('genTitle').innerText=L[lang].title;document.getElementById('startBtn').innerText=running?L[lang].pause:L[lang].start;document.getElementById('clearBtn').innerText=L[lang].clear;document.getElementById('lblBaud').innerText=L[lang].baud;document.querySelectorAll('.lblSensor').forEach(e=>e.innerText=L[lang].sensor);document.querySelectorAll('.lblSentence').forEach(e=>e.innerText=L[lang].sentenceSel);document.querySelectorAll('.lblIntervalSlot').forEach(e=>e.innerText=L[lang].interval);}
+window.addEventListener('beforeunload',()=>{Object.keys(pending).forEach(i=>pushSlot(+i));});
+document.addEventListener('DOMContentLoaded',async()=>{con=VConsole(document.getElementById('genconsole'),'/getgen');con.run(()=>!document.hidden);fetch('/setmode?m=generator');lang=localStorage.getItem('lang')||'en';const [slots]=await Promise.all([getSlots(),getCatalog()]);for(let i=0;i<slots.length;i++){buildSlot(i,slots[i]);initSlot(i);}const st=await getStatus();running=!!st.genRunning;applyLang();var b=document.getElementById('gen_baud_'+(st.baud||4800));if(b)b.classList.add('active');});
@@ -0,0 +1,12 @@
+let lang=localStorage.getItem('lang')||'en';
+const L={en:{t:'NMEA Link',m:'NMEA Monitor',g:'NMEA Generator',o:'OTA Update',r:'Auto-resume on boot',s:'Skip splash',d:'Suppress repeated sentences',kw:'Signal K deltas (WebSocket)',ku:'Signal K deltas (UDP 4123)',n:'NMEA 2000 input (CAN)',i:'UDP as IEC 61162-450 (multicast)',x:'Receive-time tag (c:, UTC s) on UDP/TCP'},
+es:{t:'NMEA Link',m:'NMEA Monitor',g:'NMEA Generator',o:'Actualizar Firmware',r:'Reanudar al encender',s:'Saltear splash',d:'Suprimir sentencias repetidas',kw:'Deltas Signal K (WebSocket)',ku:'Deltas Signal K (UDP 4123)',n:'Entrada NMEA 2000 (CAN)',i:'UDP como IEC 61162-450 (multicast)',x:'Tag de hora de recepción (c:, s UTC) en UDP/TCP'},
+fr:{t:'NMEA Link',m:'NMEA Monitor',g:'NMEA Generator',o:'Mise à jour OTA',r:'Reprise au démarrage',s:'Passer le splash',d:'Supprimer les phrases répétées',kw:'Deltas Signal K (WebSocket)',ku:'Deltas Signal K (UDP 4123)',n:'Entrée NMEA 2000 (CAN)',i:'UDP en IEC 61162-450 (multicast)',x:'Tag d’heure de réception (c:, s UTC) en UDP/TCP'}};
+function setLang(l){lang=l;localStorage.setItem('lang',l);apply();}
+function apply(){document.getElementById('ttl').innerText=L[lang].t||'NMEA Link';document.getElementById('b1').innerText=L[lang].m;document.getElementById('b2').innerText=L[lang].g;document.getElementById('b3').innerText=L[lang].o;document.getElementById('lResume').innerText=L[lang].r;document.getElementById('lSplash').innerText=L[lang].s;document.getElementById('lDedup').innerText=L[lang].d;document.getElementById('lSkWs').innerText=L[lang].kw;document.getElementById('lSkUdp').innerText=L[lang].ku;document.getElementById('lN2k').innerText=L[lang].n;document.getElementById('lIec').innerText=L[lang].i;document.getElementById('lRxTag').innerText=L[lang].x;document.getElementById('lang').value=lang;}
+function saveOpts(){fetch('/setconfig?autoresume='+(document.getElementById('optResume').checked?1:0)+'&skipsplash='+(document.getElementById('optSplash').checked?1:0)+'&dedup='+(document.getElementById('optDedup').checked?1:0)+'&skws='+(document.getElementById('optSkWs').checked?1:0)+'&skudp='+(document.getElementById('optSkUdp').checked?1:0)+'&n2k='+(document.getElementById('optN2k').checked?1:0)+'&iec450='+(document.getElementById('optIec').checked?1:0)+'&rxtag='+(document.getElementById('optRxTag').checked?1:0)).catch(()=>{});}
+async function loadOpts(){try{const st=await (await fetch('/getstatus')).json();document.getElementById('optResume').checked=!!st.autoResume;document.getElementById('optSplash').checked=!!st.skipSplash;document.getElementById('optDedup').checked=!!st.dedup;document.getElementById('optSkWs').checked=!!st.skWs;document.getElementById('optSkUdp').checked=!!st.skUdp;document.getElementById('optN2k').checked=!!st.n2k;document.getElementById('optIec').checked=!!st.iec450;document.getElementById('optRxTag').checked=!!st.rxTag;if(st.n2k)document.getElementById('n2kInfo').innerText=st.n2kBus?'('+st.n2kFrames+' frames)':'(bus down)';if(st.rxLines)document.getElementById('dedupInfo').innerText='('+(100*st.dedupSuppressed/st.rxLines).toFixed(1)+'%)';}catch(e){}}
+async function goMon(){try{await fetch('/togglegen?state=0');await fetch('/setmonitor?state=0');await fetch('/setmode?m=monitor');}catch(e){} location.href='/monitor';}
+async function goGen(){try{await fetch('/togglegen?state=0');await fetch('/setmonitor?state=0');await fetch('/setmode?m=generator');}catch(e){} location.href='/generator';}
+async function goOTA(){try{await fetch('/togglegen?state=0');await fetch('/setmonitor?state=0');}catch(e){} location.href='/update';}
+document.addEventListener('DOMContentLoaded',()=>{apply();loadOpts();});
@@ -0,0 +1,26 @@
+let lang=localStorage.getItem('lang')||'en';
+const Lb={en:{pause:'⏸ Pause',resume:'▶ Start',clear:'🧹 Clear'},
+es:{pause:'⏸ Pausar',resume:'▶ Iniciar',clear:'🧹 Limpiar'},
+fr:{pause:'⏸ Pause',resume:'▶ Démarrer',clear:'🧹 Effacer'}};
+const cat={
+  en:{GPS:'GPS',AIS:'AIS',SOUNDER:'SOUNDER',VELOCITY:'VELOCITY',HEADING:'HEADING',RADAR:'RADAR',WEATHER:'WEATHER',TRANSDUCER:'TRANSDUCER',OTROS:'OTHER'},
+  es:{GPS:'GPS',AIS:'AIS',SOUNDER:'ECOSONDA',VELOCITY:'VELOCIDAD',HEADING:'RUMBO',RADAR:'RADAR',WEATHER:'METEO',TRANSDUCER:'TRANSDUCTOR',OTROS:'OTROS'},
+  fr:{GPS:'GPS',AIS:'AIS',SOUNDER:'SONDEUR',VELOCITY:'VITESSE',HEADING:'CAP',RADAR:'RADAR',WEATHER:'MÉTÉO',TRANSDUCER:'TRANSDUCTEUR',OTROS:'AUTRES'}
+};
+let filters=['GPS','AIS','SOUNDER','VELOCITY','HEADING','RADAR','WEATHER','TRANSDUCER','OTROS'];let filtersState={};filters.forEach(f=>filtersState[f]=true);
+let paused=true;
+function setLang(l){lang=l;localStorage.setItem('lang',l);applyLang();}
+function applyLang(){document.getElementById('pauseBtn').innerText=paused?Lb[lang].resume:Lb[lang].pause;document.getElementById('clearBtn').innerText=Lb[lang].clear;document.getElementById('lang').value=lang;drawFilters();if(con)con.refresh();}
+function drawFilters(){let c=document.getElementById('filterC');c.innerHTML='';filters.forEach(f=>{let b=document.createElement('button');b.type='button';b.className='fbtn '+f;if(filtersState[f])b.classList.add('active');b.innerText=cat[lang][f]||f;b.onclick=()=>{filtersState[f]=!filtersState[f];b.classList.toggle('active',filtersState[f]);saveFilters();};c.appendChild(b);});let all=document.createElement('button');all.type='button';all.className='fbtn';all.innerText='ALL/NONE';all.onclick=()=>{let any=Object.values(filtersState).some(v=>v);Object.keys(filtersState).forEach(k=>filtersState[k]=!any);drawFilters();saveFilters();};c.appendChild(all);}
+function filterMask(){let m=0;filters.forEach((f,i)=>{if(filtersState[f])m|=(1<<i);});return m;}
+function saveFilters(){fetch('/setfilters?mask='+filterMask()).catch(()=>{});}
+function togglePause(){paused=!paused;applyLang();fetch('/setmonitor?state='+(paused?0:1)).catch(()=>{});}
+function clearConsole(){if(con)con.clear();fetch('/clearnmea').catch(()=>{});}
+async function setBaud(b){await fetch('/setbaud?baud='+b).catch(()=>{});document.querySelectorAll('.baud').forEach(x=>x.classList.remove('active'));let el=document.getElementById('baud_'+b);if(el)el.classList.add('active');}
+// "[GPS] $GPRMC,..." → categoría; las filtradas no entran a la consola
+function lineType(l){let lb=l.indexOf(']');return (lb>0&&l[0]=='[')?l.substring(1,lb):'OTROS';}
+function fillLine(d,l){let typ=lineType(l),lb=l.indexOf(']');let sp=document.createElement('span');sp.className=typ;sp.textContent='['+(cat[lang][typ]||typ)+']'+((lb>=0)?l.substring(lb+1):l);d.appendChild(sp);}
+let con=null;
+async function gotoGen(){paused=true;applyLang();try{await fetch('/setmonitor?state=0');await fetch('/setmode?m=generator');}catch(e){} location.href='/generator';}
+async function gotoMenu(){paused=true;try{await fetch('/setmonitor?state=0');await fetch('/togglegen?state=0');}catch(e){} location.href='/';}
+document.addEventListener('DOMContentLoaded',async()=>{con=VConsole(document.getElementById('console'),'/getnmea',{fill:fillLine,accept:l=>filtersState[lineType(l)]!==false});await fetch('/setmode?m=monitor');try{const st=await (await fetch('/getstatus')).json();paused=!st.monRunning;if(typeof st.filters==='number')filters.forEach((f,i)=>filtersState[f]=!!(st.filters&(1<<i)));applyLang();let b=document.getElementById('baud_'+(st.baud||4800));if(b)b.classList.add('active');}catch(e){applyLang();}con.run(()=>!paused&&!document.hidden);});
@@ -0,0 +1,9 @@
+let lang=localStorage.getItem('lang')||'en';const T={
+  en:{title:'OTA Update',msg:'Select the firmware .bin file and upload. The device will reboot automatically.',upload:'Upload',menu:'🏠 Main Menu',ok:'Upload OK. Rebooting…',fail:'Upload failed.'},
+  es:{title:'Actualizar Firmware',msg:'Selecciona el archivo .bin y súbelo. El equipo se reiniciará automáticamente.',upload:'Subir',menu:'🏠 Menú Principal',ok:'Subida OK. Reiniciando…',fail:'Fallo en la subida.'},
+  fr:{title:'Mise à jour OTA',msg:'Sélectionnez le fichier .bin et téléversez-le. L’appareil redémarrera automatiquement.',upload:'Téléverser',menu:'🏠 Menu Principal',ok:'Téléversement OK. Redémarrage…',fail:'Échec du téléversement.'}
+};
+function apply(){document.getElementById('ttl').innerText=T[lang].title;document.getElementById('btnUp').innerText=T[lang].upload;document.getElementById('btnMenu').innerText=T[lang].menu;}apply();
+let up=0;// 0 = subiendo, 1 = cuerpo recibido por el equipo, -1 = rechazado
+function poll(){if(up<0)return;fetch('/otastatus').then(r=>r.json()).then(s=>{const el=document.getElementById('status');if(up>0&&s.state==='ok'){el.innerText=T[lang].ok;setTimeout(()=>{location.href='/'},8000);return;}if(up>0&&s.state==='fail'){el.innerText=T[lang].fail+' ('+s.err+')';return;}if(s.state==='receiving'||s.state==='verifying')el.innerText=T[lang].msg+' '+(s.total?Math.min(100,Math.round(100*s.received/s.total)):0)+'%';setTimeout(poll,500);}).catch(()=>setTimeout(poll,1000));}
+function doUpload(){const f=document.getElementById('file').files[0];if(!f){document.getElementById('status').innerText='No file';return;}const fd=new FormData();fd.append('update',f,f.name);document.getElementById('status').innerText=T[lang].msg;up=0;fetch('/update',{method:'POST',body:fd}).then(r=>r.text()).then(t=>{if(t.trim()==='RECEIVED'){up=1;}else{up=-1;document.getElementById('status').innerText=T[lang].fail+' ('+t+')';}}).catch(()=>{up=-1;document.getElementById('status').innerText=T[lang].fail;});poll();}